@@ -7,13 +7,14 @@
  .cdecls C,LIST,	"msp430fg4618.h"
  .global EN_DELAY
  .global delay
+ .global ks0108_EnDelay
 
 	.text
 
 ; these functions are declared in msp.h
 
 ; simple busy loop for the enable pulse that causes the LCD to accept a command
-EN_DELAY	mov.w	#6, R12 ; the 6 is EN_DELAY_VALUE (see ks0108_Panel.h)
+EN_DELAY	mov.w	&ks0108_EnDelay, R12 ; starts out as EN_DELAY_VALUE (see ks0108_Panel.h)
 edloop		dec.w	R12
 			and.w	R12, R12
 			jne		edloop
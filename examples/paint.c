@@ -35,12 +35,44 @@
 #include "touchscreen.h"
 #include "msp.h"
 #include "ks0108.h"
+#include "ks0108_stroke.h"
 
 volatile enum { DRAW, SCROLL } mode = DRAW;
 volatile enum { PENCIL, ERASER } drawmode = PENCIL;
 
+#define STATUSBAR_WIDTH 12 // columns of the top page used by the status bar
+#define FLUSH_BUDGET 16    // bus transactions sent to the LCD per tick of Timer A
+#define TOUCH_BATCH 8      // touch samples taken from the queue per pass of the main loop
+#define PENCIL_WIDTH 1     // brush sizes in pixels
+#define ERASER_WIDTH 12
+#define FLUSH_TICK 1000    // Timer A counts of 1 us between flush steps
+
+// where interrupts are off, for TRACE_IRQOFF in KS0108_TRACE builds
+// (2 is ADC12_ISR, see touchpanel.c)
+#define IRQOFF_SLEEP 0     // the main loop deciding whether to sleep
+#define IRQOFF_BUTTONS 1   // Port1_ISR
+
+#ifdef KS0108_TRACE
+volatile char dumpTrace = 0; // both buttons were pressed: send the trace to the PC
+void SetupUart(void);
+void UartPut(uint8_t byte);
+#endif
+
+void UpdateStatusBar(void);
+
+ks0108_stroke pen; // joins up the samples of a stroke (drawn at once, sent once per frame, see the end of the main loop)
+
+// where the edges of the touch panel land on the screen (touchcal_solve can
+// replace this with a calibration from three touches)
+touchCal calibration = TOUCHCAL_RANGES(TOUCH_X_MIN, TOUCH_X_MAX, 0, DISPLAY_WIDTH,
+                                       TOUCH_Y_MIN, TOUCH_Y_MAX, DISPLAY_HEIGHT - 1, -1);
+
 void main(void) {
-      int x = 0, y = 0, newx, newy, i;
+      int x = 0, y = 0, newx, newy, starty = 0, i, n;
+      char touching = 0;                        // the last sample had the pen down
+      uint16_t s;                               // interrupt state for KS0108_LOCK
+      touchSample samples[TOUCH_BATCH];
+      KS0108_TRACE_DECL(t)
       
       // chain watchdog to a tree
       WDTCTL = WDTPW + WDTHOLD;                 // Stop watchdog timer
@@ -75,139 +107,148 @@ void main(void) {
       // Setup Timer B to trigger interrupts which will trigger conversion
       TBCCTL0 = CCIE;
       TBCTL = TBSSEL_2 + MC_1;  // SMCLK, up-mode
-      TBCCR0 = 24000;           // slow down to remove inconsistencies
+      TBCCR0 = 8000;            // 1 ms per conversion, so a reading every 2 ms (touchFilter settles the pen)
       
       ADC12CTL0 |= ENC;            // enable conversion
       
+      // Timer A sends the buffer to the LCD a little at a time in the background,
+      // so drawing and the touch panel ISRs never wait for a whole flush. It runs
+      // continuously (TA0_ISR moves the compare on), so TAR is also a free-running
+      // 1 MHz clock for the instrumentation
+      TACCTL0 = CCIE;
+      TACTL = TASSEL_2 + ID_3 + MC_2; // SMCLK/8, continuous mode
+      TACCR0 = FLUSH_TICK;      // 1 ms
+#ifdef KS0108_TRACE
+      SetupUart();
+#endif
+      
       ks0108_Init(&GLCD, 0);    // initialize screens
+      ks0108_StrokeInit(&pen, &GLCD);
+      GLCD.pinnedWidth = STATUSBAR_WIDTH; // the status bar is pinned to the top left of the screen
+      UpdateStatusBar();
       ks0108_DumpBuffer(&GLCD); // clear the screens and put up status bar
       
       while (1)
       {
-          __bis_SR_register(LPM0_bits + GIE);     // go to sleep until ADC12_ISR
+          // sleep until ADC12_ISR has queued something (turning interrupts back
+          // on and going to sleep is one instruction, so a sample can't slip in
+          // between the check and the sleep)
+          __bic_SR_register(GIE);
+          KS0108_TRACE_BEGIN(t, TRACE_IRQOFF, IRQOFF_SLEEP);
+          n = touch_pending();
+          KS0108_TRACE_END(t, TRACE_IRQOFF, IRQOFF_SLEEP);
+          if (n == 0)
+              __bis_SR_register(LPM0_bits + GIE);
+          __bis_SR_register(GIE);
           
-          __bic_SR_register(GIE);                 // turn off interrupts while we draw stuff
+#ifdef KS0108_TRACE
+          if (dumpTrace)                                   // send what has happened since the last dump
+          {
+              dumpTrace = 0;
+              ks0108_TraceDump(UartPut);
+              ks0108_TraceClear();
+          }
+#endif
           
         // turn on the chips in case they've turned themselves off
-        ks0108_WriteCommand(&GLCD, 0x3F, 0);
-        ks0108_WriteCommand(&GLCD, 0x3F, 1);
-                  
-          if (xx > 500 && xx < 2900 && yy > 700 && yy < 3500 && wasvalid > IGNORE+1) // range check
-                    // see touchpanel.h for explanation of the startup transient problem
+        ks0108_WriteCommand(&GLCD, LCD_ON, CHIP_ALL);
+        
+        // take everything the touch panel has read since the last pass, with
+        // interrupts on: the driver locks what it shares with Timer A by itself
+        n = touch_read(samples, TOUCH_BATCH);
+        for (i = 0; i < n; i++)
+        {
+          if (!samples[i].valid)                                       // the pen went up
           {
-              newx = (xx - 500)/19;                                    // scale touch panel coordinates to LCD coordinates
-              newy = 63 - (yy - 700)/44;
+              touching = 0;
+              ks0108_StrokeLift(&pen);
+              continue;
+          }
+          touchcal_map(&calibration, samples[i].x, samples[i].y, &newx, &newy); // scale touch panel coordinates to LCD coordinates
+          if (!touching)                                               // the start of a stroke or drag
+          {
+              touching = 1;
+              starty = newy;
+          }
 
-              if (newx != x || newy != y)                              // only draw if the coordinates have changed
+              if (newx != x || newy != y || !pen.down)                 // only draw if the coordinates have changed (or a stroke starts)
               {
                   x = newx;                                            // remember the new coordinates
                   y = newy;
-                  if (mode == DRAW && (x > 63 || y > 8))               // status bar is read only
+                  if (mode == DRAW && (x >= STATUSBAR_WIDTH || y > 7)) // status bar is read only
+                  {
+                      if (drawmode == PENCIL)                          // a line from the last sample, however far the pen moved
+                          ks0108_StrokeBrush(&pen, PENCIL_WIDTH, BLACK);
+                      else                                             // ERASER, a 12x12 square swept along the same way
+                          ks0108_StrokeBrush(&pen, ERASER_WIDTH, WHITE);
+                      ks0108_StrokeTo(&pen, x, y);
+                  }
+                  else if (mode == DRAW)                               // crossing the status bar breaks the line
                   {
-                      if (drawmode == PENCIL)                          // the pencil is drawing a pixel
-                      {
-                          ks0108_SetDot(&GLCD, x, y, BLACK);
-                      }
-                      else                                             // ERASER
-                      {
-                          for (newx = x - 6; newx < x + 6; ++newx)     // the eraser is a 12x12 square
-                          {
-                              for (newy = y - 6; newy < y + 6; ++newy) // clear these pixels
-                              {
-                                  ks0108_SetDot(&GLCD, newx, newy, WHITE);
-                              }
-                          }
-                      }
+                      ks0108_StrokeLift(&pen);
                   }
                   else // SCROLL
                   {
-                    // the way scrolling works is we remember the first valid coordinates
-                    // (firstx, firsty) and when the y coordinate changes by more than 8
-                    // (in units of LCD pixels) we scroll the display by 8 pixels in the
-                    // appropriate direction, then reset firsty to the current position.
+                    // the way scrolling works is we remember where the drag started
+                    // (starty) and when the y coordinate changes we scroll the
+                    // display by the same number of pixels in the opposite direction, then
+                    // reset starty to the current position. The chips' display start line
+                    // does the scrolling, so only the rows that come into view are redrawn.
                     // This allows scrolling by dragging on the touch panel, much like two-finger
                     // scrolling on a Macbook or the hand tool in Adobe PDF Reader.
-                    if (firsty - y > 8)
+                    if (starty != y)
                     {
-                        if (GLCD.startline < 192)               // don't go below the bottom
-                        {
-                            GLCD.startline += 8;                // scroll
-                            ks0108_DumpBuffer(&GLCD);           // refresh display
-                        }
-                        firsty = y;
-                    }
-                    else if (y - firsty > 8)
-                    {
-                        if (GLCD.startline > 0)                 // don't go above the top
-                        {
-                            GLCD.startline -= 8;                // scroll
-                            ks0108_DumpBuffer(&GLCD);           // refresh display
-                        }
-                        firsty = y;
+                        ks0108_StrokeCommit(&pen);              // hand over the damage before the window moves
+                        ks0108_SetStartLine(&GLCD, ks0108_TopLine(&GLCD) + starty - y); // scroll (stops at the top and bottom)
+                        KS0108_LOCK(s);                         // Port1_ISR redraws the status bar too, so it can't
+                        UpdateStatusBar();                      // change the mode under this one and be overwritten
+                        KS0108_UNLOCK(s);                       // (moves the scrollbar, Timer A redraws)
+                        starty = y;
                     }
                   }
               }
-          }
-        
-        _bis_SR_register(GIE); // turn interrupts back on
-        
+        }
+          
+        // a frame: once Timer A has sent the last batch of strokes, mark the ones
+        // drawn since dirty together (a fast stroke crosses the same bytes many
+        // times, each of them is only sent once per frame)
+        if (!ks0108_FlushPending(&GLCD))
+            ks0108_StrokeCommit(&pen);
       }
 }
 
-// dump the in-RAM screen buffer out to the display
-//    (i.e., the part of it currently displayed, which
-//    is determined by GLCD.startline)
-// this isn't as slow as you would think
-// even though this is declared in ks0108.h, it has to be implemented here
-//      because it needs to know about mode and drawmode for the status bar
-//      (in the future they really should be decoupled)
-void ks0108_DumpBuffer(volatile ks0108 *this)
+// draw the status bar into the pinned overlay (the top 8 rows of the
+//    screen, which don't scroll with the buffer). Only the columns that
+//    change are marked dirty, so the next flush sends just those.
+void UpdateStatusBar(void)
 {
-    uint8_t chip, x, y, i;
-    for (chip = 0; chip < 2; ++chip) // two LCD chips
+    uint8_t y, i, pos;
+    
+    // pixel 0: on if draw mode
+    ks0108_SetPinned(&GLCD, 0, (mode == DRAW) ? 0xFF : 0);
+    
+    // pixel 1: top half if pencil, bottom half if eraser
+    ks0108_SetPinned(&GLCD, 1, (drawmode == PENCIL) ? 0xF0 : 0x0F);
+    
+    // pixel 2: on if erase mode
+    ks0108_SetPinned(&GLCD, 2, (mode == SCROLL) ? 0xFF : 0);
+    
+    // pixel 3: off
+    ks0108_SetPinned(&GLCD, 3, 0);
+    
+    // pixels 4-11: scrollbar
+    //      see the code description document
+    //      for an explanation of the scrollbar shape
+    //      (pos goes from 0 at the top of the canvas to 24 at the bottom)
+    pos = (long)ks0108_TopLine(&GLCD) * 24 / ((CANVAS_SCREENS-1)*DISPLAY_HEIGHT);
+    for (y = 0; y < 8; ++y)
     {
-        if (chip == 0) // the top page of the left chip is used for a status bar
-        {
-            ks0108_WriteCommand(this, 0xB8, chip); // chipX = 0
-            ks0108_WriteCommand(this, 0x40, chip); // chipY = 0
-            
-            // pixel 0: on if draw mode
-            ks0108_DoWriteCommand(this, (mode == DRAW) ? 0xFF : 0, chip, 1, 0);
-            
-            // pixel 1: top half if pencil, bottom half if eraser
-            ks0108_DoWriteCommand(this, (drawmode == PENCIL) ? 0xF0 : 0x0F, chip, 1, 0);
-            
-            // pixel 2: on if erase mode
-            ks0108_DoWriteCommand(this, (mode == SCROLL) ? 0xFF : 0, chip, 1, 0);
-            
-            // pixel 3: off
-            ks0108_DoWriteCommand(this, 0, chip, 1, 0);
-            
-            // pixels 4-11: scrollbar
-            //      see the code description document
-            //      for an explanation of the scrollbar shape
-            for (y = 0; y < 8; ++y)
-            {
-                i = 0;
-                if (this->startline/XPAGES > y) i |= 0xC0;
-                if (this->startline/XPAGES > 8+y) i |= 0x30;
-                if (this->startline/XPAGES > 16+y) i |= 0xC;
-                if (this->startline/XPAGES > 24+y) i |= 0x3;
-                ks0108_DoWriteCommand(this, i, chip, 1, 0);
-            }
-        }
-        for (x = 1-chip; x < 8; ++x) // start at the second page on the left chip, but the first page on the right chip
-        {
-            ks0108_WriteCommand(this, x | 0xB8, chip);  // set chipX
-            ks0108_WriteCommand(this, 0x40, chip);      // set chipY
-            for (y = 0; y < 64; ++y)                    // write out the page
-            {
-                ks0108_DoWriteCommand(this, this->buffer[x + this->startline/XPAGES][y + CHIP_WIDTH*chip], chip, 1, 0);
-                // like the calls for chip==0 above, this call to DoWriteCommand is actually writing
-                // a byte of pixel data to the screen (you can see that if you correlate the values
-                // of D_I(RS) and R_W with the ks0108 datasheet
-            }
-        }
+        i = 0;
+        if (pos > y) i |= 0xC0;
+        if (pos > 8+y) i |= 0x30;
+        if (pos > 16+y) i |= 0xC;
+        if (pos > 24+y) i |= 0x3;
+        ks0108_SetPinned(&GLCD, 4+y, i);
     }
 }
 
@@ -215,12 +256,18 @@ void ks0108_DumpBuffer(volatile ks0108 *this)
 __interrupt void Port1_ISR()                                // handle button events
 {
     int chip, y, i, j;
+    KS0108_TRACE_DECL(t)
     __bic_SR_register(GIE);                                 // turn off interrupts so we can process this one in peace
+    KS0108_TRACE_BEGIN(t, TRACE_IRQOFF, IRQOFF_BUTTONS);
     
+#ifdef KS0108_TRACE
+    if ((P1IN & 0x03) == 0)                                 // both buttons down: dump the trace (from the main loop)
+        dumpTrace = 1;
+#endif
     if (P1IFG & 0x01)
     {
         drawmode = (drawmode == PENCIL) ? ERASER : PENCIL;  // change drawing tool
-        ks0108_DumpBuffer(&GLCD);                           // so that the status bar gets redrawn
+        UpdateStatusBar();                                  // only the status bar gets redrawn (by Timer A)
         
         CLRBIT(P1IFG, 0);                                   // clear interrupt flag
     }
@@ -228,11 +275,45 @@ __interrupt void Port1_ISR()                                // handle button eve
     {
         mode = (mode == DRAW) ? SCROLL : DRAW;              // change mode
         lopass = 1 - lopass;                                // no low-pass filter in scroll mode (see touchscreen.{c,h})
-        ks0108_DumpBuffer(&GLCD);                           // so that the status bar gets redrawn
+        UpdateStatusBar();                                  // only the status bar gets redrawn (by Timer A)
         
         delay(20);                                          // try to prevent the chips from turning off
         CLRBIT(P1IFG, 1);                                   // clear interrupt flag
     }
     
+    KS0108_TRACE_END(t, TRACE_IRQOFF, IRQOFF_BUTTONS);
     __bis_SR_register(GIE);                                 // turn interrupts back on
 }
+
+#pragma vector=TIMERA0_VECTOR
+__interrupt void TA0_ISR(void)
+{
+    // send the next few bytes of whatever has been drawn. The driver talks to
+    // the LCD under KS0108_LOCK, so this never lands in the middle of another
+    // bus transaction, and FLUSH_BUDGET bounds how long the touch panel ISRs
+    // can be held off.
+    TACCR0 += FLUSH_TICK;
+    KS0108_TRACE_TICK();                                    // TAR goes round every 65 ms
+    ks0108_FlushStep(&GLCD, FLUSH_BUDGET);
+}
+
+#ifdef KS0108_TRACE
+// the trace goes to the PC over USCI_A0 (P2.4), 115200 baud 8N1
+void SetupUart(void)
+{
+    UCA0CTL1 |= UCSWRST;
+    UCA0CTL1 = UCSSEL_2 + UCSWRST;                          // SMCLK
+    UCA0BR0 = 69;                                           // 8 MHz / 115200 = 69.44
+    UCA0BR1 = 0;
+    UCA0MCTL = UCBRS_4;                                     // 0.44 * 8 = 3.5
+    P2SEL |= 0x30;                                          // P2.4 TXD, P2.5 RXD
+    UCA0CTL1 &= ~UCSWRST;
+}
+
+void UartPut(uint8_t byte)
+{
+    while (!(IFG2 & UCA0TXIFG))
+        ;
+    UCA0TXBUF = byte;
+}
+#endif
@@ -0,0 +1,755 @@
+/* bench.c
+ * bus transaction counts for the ks0108 driver entry points, measured on the
+ * bus model in ks0108_sim.c (build and run with "make run" in this directory)
+ *
+ * "bench budgets.txt" also holds every scenario to its budget in that file
+ * (the section named after the program) and fails if one goes over.
+ * Built with KS0108_TRACE, it writes the instrumentation dump of the paint
+ * session replay to trace.bin (see tracedecode.c).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ks0108.h"
+#include "ks0108_sim.h"
+#include "ks0108_list.h"
+#include "ks0108_stroke.h"
+#include "SystemFont5x7.h"
+#include "Narrow5x7.h"
+#include "session.h"
+
+ks0108 GLCD; // the driver instance (msp.c is not built on the host)
+#ifdef KS0108_MULTIPANEL
+static ks0108 second, third; // the panels at EN2 and EN3
+#endif
+
+// a 10x12 sprite: a ring, with a mask that also covers the inside
+static const uint8_t sprite[2 + 20] = {
+    10, 12,
+    0xF0, 0x0C, 0x02, 0x02, 0x01, 0x01, 0x02, 0x02, 0x0C, 0xF0,
+    0x00, 0x03, 0x04, 0x04, 0x08, 0x08, 0x04, 0x04, 0x03, 0x00
+};
+static const uint8_t spriteMask[2 + 20] = {
+    10, 12,
+    0xF0, 0xFC, 0xFE, 0xFE, 0xFF, 0xFF, 0xFE, 0xFE, 0xFC, 0xF0,
+    0x00, 0x03, 0x07, 0x07, 0x0F, 0x0F, 0x07, 0x07, 0x03, 0x00
+};
+
+// compare the glass with what the buffer and the pinned overlay say it should show
+// (of the panel that ks0108_SimPanel looks at)
+static int CheckPanel(ks0108 *glcd, const char *label)
+{
+    int x, y, row, want;
+
+    for(y = 0; y < DISPLAY_HEIGHT; y++) {
+        for(x = 0; x < DISPLAY_WIDTH; x++) {
+            row = glcd->startline + y;
+            if(y < 8 && x < glcd->pinnedWidth)
+                want = (glcd->pinned[x] >> y) & 1;
+            else
+                want = (glcd->buffer[row/8][glcd->startcol + x] >> (row%8)) & 1;
+            if(glcd->Inverted)
+                want = !want;
+            if(ks0108_SimPixel(x, y) != want) {
+                fprintf(stderr, "bench: %s: glass differs from the buffer at %d,%d\n", label, x, y);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static int check(const char *label)
+{
+    return CheckPanel(&GLCD, label);
+}
+
+#ifdef KS0108_TILED
+// a hash of what the glass shows
+static unsigned long glass(void)
+{
+    unsigned long hash = 5381;
+    int x, y;
+
+    for(y = 0; y < DISPLAY_HEIGHT; y++)
+        for(x = 0; x < DISPLAY_WIDTH; x++)
+            hash = hash*33 + ks0108_SimPixel(x, y);
+    return hash;
+}
+#endif
+
+// budgets for the counters that SimPrintStats prints, by scenario label
+#define MAX_BUDGETS 64
+#define COUNTERS 8
+static const char *counterNames[COUNTERS] = { "en", "cmd", "wr", "rd", "status", "spin", "lost", "cycles" };
+
+typedef struct {
+    char label[40];
+    unsigned long limit[COUNTERS];
+    uint8_t set;                // bit per counter that has a limit
+    uint8_t used;               // the scenario ran
+} budget;
+
+static budget budgets[MAX_BUDGETS];
+static int budgetCount, overBudget;
+
+// read the section of file for this build, lines like
+//   [bench-tiled]
+//   Scroll +3: en 152 cycles 23699
+// (a section can be for more than one build: [bench bench-trace])
+static int LoadBudgets(const char *file, const char *section)
+{
+    char line[200], *colon, *name, *value;
+    int in = 0, i;
+    FILE *f = fopen(file, "r");
+
+    if(!f) {
+        fprintf(stderr, "bench: can't read %s\n", file);
+        return 1;
+    }
+    while(fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = 0;
+        if(line[0] == '#' || line[0] == 0)
+            continue;
+        if(line[0] == '[') {
+            line[strcspn(line, "]")] = 0;
+            in = 0;
+            for(name = strtok(line + 1, " \t"); name; name = strtok(NULL, " \t"))
+                in |= strcmp(name, section) == 0;
+            continue;
+        }
+        if(!in || !(colon = strchr(line, ':')) || budgetCount == MAX_BUDGETS)
+            continue;
+        *colon = 0;
+        memset(&budgets[budgetCount], 0, sizeof(budget));
+        sprintf(budgets[budgetCount].label, "%.39s", line);
+        for(name = strtok(colon + 1, " \t"); name && (value = strtok(NULL, " \t")); name = strtok(NULL, " \t")) {
+            for(i = 0; i < COUNTERS && strcmp(name, counterNames[i]) != 0; i++)
+                ;
+            if(i == COUNTERS) {
+                fprintf(stderr, "bench: %s: unknown counter %s for %s\n", file, name, line);
+                fclose(f);
+                return 1;
+            }
+            budgets[budgetCount].limit[i] = strtoul(value, NULL, 10);
+            budgets[budgetCount].set |= 1 << i;
+        }
+        budgetCount++;
+    }
+    fclose(f);
+    return 0;
+}
+
+// print the counters of a scenario and hold them to its budget
+static void report(const char *label)
+{
+    ks0108_SimStats *s = &ks0108_SimStat;
+    unsigned long now[COUNTERS];
+    int b, i;
+
+    now[0] = s->enables;
+    now[1] = s->commands;
+    now[2] = s->writes;
+    now[3] = s->reads;
+    now[4] = s->statusReads;
+    now[5] = s->busySpins;
+    now[6] = s->lostWrites;
+    now[7] = s->cycles;
+    ks0108_SimPrintStats(stdout, label);
+    // a lost write is a wrong picture, not a cost, so no budget allows one
+    if(now[6]) {
+        fprintf(stderr, "bench: %s: %lu writes were lost\n", label, now[6]);
+        overBudget = 1;
+    }
+    for(b = 0; b < budgetCount && strcmp(budgets[b].label, label) != 0; b++)
+        ;
+    if(b == budgetCount)
+        return;
+    budgets[b].used = 1;
+    for(i = 0; i < COUNTERS; i++) {
+        if((budgets[b].set & (1 << i)) && now[i] > budgets[b].limit[i]) {
+            fprintf(stderr, "bench: %s: %s %lu is over its budget of %lu\n", label, counterNames[i],
+                    now[i], budgets[b].limit[i]);
+            overBudget = 1;
+        }
+    }
+}
+
+#ifdef KS0108_TRACE
+static FILE *traceFile;
+
+static void TracePut(uint8_t byte)
+{
+    fputc(byte, traceFile);
+}
+#endif
+
+static int flushesDone;
+
+// one tick of Timer A in paint.c, returns the bus transactions it took
+static unsigned long PaintTick(void)
+{
+    unsigned long enables = ks0108_SimStat.enables;
+
+    ks0108_FlushStep(&GLCD, 16);
+    return ks0108_SimStat.enables - enables;
+}
+
+static void FlushDone(ks0108 *this)
+{
+    flushesDone++;
+}
+
+// the corners of a scribble, as a touch panel samples a fast stroke
+static const ks0108_strokePoint strokePoints[17] = {
+    {10, 20, 1}, {30, 12, 1}, {52, 40, 1}, {54, 41, 1}, {90, 58, 1}, {120, 30, 1}, {100, 2, 1}, {60, 10, 1},
+    {20, 62, 1}, {2, 50, 1}, {8, 30, 1}, {40, 30, 1}, {41, 31, 1}, {70, 20, 1}, {126, 50, 1}, {64, 32, 1},
+    {0, 0, 0}
+};
+
+// a line with a square brush the slow way: a FillRect at every pixel DrawLine would set
+static void BrushLine(int x1, int y1, int x2, int y2, int width)
+{
+    int dx = x2 > x1 ? x2 - x1 : x1 - x2, dy = y2 > y1 ? y1 - y2 : y2 - y1;
+    int sx = x1 < x2 ? 1 : -1, sy = y1 < y2 ? 1 : -1, err = dx + dy, e2;
+
+    while(1) {
+        ks0108_FillRect(&GLCD, x1 - width/2, y1 - width/2, width - 1, width - 1, BLACK);
+        if(x1 == x2 && y1 == y2)
+            break;
+        e2 = 2*err;
+        if(e2 >= dy) {
+            err += dy;
+            x1 += sx;
+        }
+        if(e2 <= dx) {
+            err += dx;
+            y1 += sy;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int x, y, page, ticks, steps, failed = 0;
+    unsigned long enables, worst;
+    uint8_t run[100], saved[XPAGES*SCREENS][CANVAS_WIDTH], drawn[XPAGES*SCREENS][CANVAS_WIDTH];
+    ks0108_list list;
+    ks0108_stroke stroke;
+    const sessionSample *sample;
+    const char *name;
+#ifdef KS0108_MULTIPANEL
+    ks0108_pins pins;
+    ks0108 *panels[3] = { &GLCD, &second, &third };
+    char label[40];
+    unsigned long serial;
+#endif
+#ifdef KS0108_TILED
+    unsigned long hashes[CANVAS_SCREENS];
+#endif
+
+    if(argc > 1) {
+        name = strrchr(argv[0], '/');
+        if(LoadBudgets(argv[1], name ? name + 1 : argv[0]))
+            return 1;
+    }
+
+    ks0108_SimReset();
+    ks0108_Init(&GLCD, 0);
+    report("Init");
+
+    ks0108_SimClearStats();
+    ks0108_ClearScreen(&GLCD, WHITE);
+    report("ClearScreen");
+
+    ks0108_SimClearStats();
+    ks0108_ClearPage(&GLCD, 3, BLACK);
+    report("ClearPage");
+
+    ks0108_SimClearStats();
+    ks0108_GotoXY(&GLCD, 70, 40);
+    report("GotoXY");
+
+    ks0108_ClearScreen(&GLCD, WHITE);
+    ks0108_SimClearStats();
+    ks0108_SetDot(&GLCD, 70, 40, BLACK);
+    report("SetDot");
+
+    ks0108_SimClearStats();
+    for(y = 20; y < 32; y++)
+        for(x = 80; x < 92; x++)
+            ks0108_SetDot(&GLCD, x, y, WHITE);
+    report("SetDot x144 (eraser)");
+    failed |= check("SetDot");
+
+    // something to erase, so the glass mirror cannot skip the whole area
+    ks0108_FillRect(&GLCD, 30, 14, 11, 11, BLACK);
+    ks0108_Flush(&GLCD);
+    ks0108_SimClearStats();
+    ks0108_EraseRect(&GLCD, 30, 14, 11, 11);
+    report("EraseRect 12x12");
+    failed |= check("EraseRect");
+
+    // a recognisable picture in every page of the buffer
+    for(page = 0; page < XPAGES*SCREENS; page++)
+        for(x = 0; x < CANVAS_WIDTH; x++)
+            GLCD.buffer[page][x] = (uint8_t)(page*37 + x*11) ^ (x & 8 ? 0x5A : 0);
+
+    for(x = 0; x < 100; x++)
+        run[x] = x ^ 0xA5;
+    ks0108_SimClearStats();
+    ks0108_WritePageRun(&GLCD, 5, 20, run, 100);
+    report("WritePageRun 100 bytes");
+    for(x = 0; x < 100; x++) {
+        if(ks0108_SimRam((20+x)/CHIP_WIDTH, 5, (20+x)%CHIP_WIDTH) != run[x]) {
+            fprintf(stderr, "bench: WritePageRun: byte %d is wrong\n", x);
+            failed = 1;
+            break;
+        }
+    }
+
+    GLCD.pinnedWidth = 12; // the status bar in examples/paint.c
+    ks0108_SetPinned(&GLCD, 4, 0xC0);
+    ks0108_SimClearStats();
+    ks0108_DumpBuffer(&GLCD);
+    report("DumpBuffer");
+    failed |= check("DumpBuffer");
+
+    ks0108_SimClearStats();
+    ks0108_DumpBuffer(&GLCD);
+    report("DumpBuffer (unchanged)");
+    failed |= check("DumpBuffer (unchanged)");
+
+    ks0108_SimClearStats();
+    ks0108_FillRect(&GLCD, 30, 20, 9, 9, BLACK);        // a 10% change
+    ks0108_FillRect(&GLCD, 90, 40, 9, 9, BLACK);
+    ks0108_FillRect(&GLCD, 60, 3, 9, 9, WHITE);
+    ks0108_DumpBuffer(&GLCD);
+    report("DumpBuffer (3 boxes)");
+    failed |= check("DumpBuffer (3 boxes)");
+
+    ks0108_SimClearStats();
+    ks0108_SetPinned(&GLCD, 0, 0xFF);
+    ks0108_SetPinned(&GLCD, 1, 0x0F);
+    ks0108_Flush(&GLCD);
+    report("Flush (status bar)");
+    failed |= check("Flush");
+
+    ks0108_SimClearStats();
+    ks0108_Scroll(&GLCD, 8);
+    report("Scroll +8");
+    failed |= check("Scroll +8");
+
+    ks0108_SimClearStats();
+    ks0108_Scroll(&GLCD, 3);
+    report("Scroll +3");
+    failed |= check("Scroll +3");
+
+    ks0108_Scroll(&GLCD, -7);
+    failed |= check("Scroll -7");
+    ks0108_Scroll(&GLCD, 100);
+    failed |= check("Scroll +100");
+    ks0108_Scroll(&GLCD, 1000);
+    failed |= check("Scroll to the bottom");
+    ks0108_Scroll(&GLCD, -61);
+    failed |= check("Scroll -61");
+
+    for(x = 0; x < DISPLAY_WIDTH; x += 3)
+        ks0108_SetDot(&GLCD, x, (x*7) % DISPLAY_HEIGHT, x & 4 ? WHITE : BLACK);
+    failed |= check("SetDot after scrolling");
+
+    ks0108_SimClearStats();
+    if(ks0108_Verify(&GLCD) != 0) {
+        fprintf(stderr, "bench: Verify found bytes that differ\n");
+        failed = 1;
+    }
+    report("Verify");
+
+    ks0108_SimClearStats();
+    ks0108_FillRect(&GLCD, 20, 5, 60, 30, WHITE);
+    ks0108_DrawRect(&GLCD, 22, 7, 56, 26, BLACK);
+    ks0108_DrawLine(&GLCD, 22, 7, 78, 33, BLACK);
+    ks0108_DrawLine(&GLCD, 78, 7, 22, 33, BLACK);
+    ks0108_DrawCircle(&GLCD, 50, 20, 9, BLACK);
+    ks0108_DrawVertLine(&GLCD, 100, -10, 200, BLACK);
+    report("Draw (buffer only)");
+    ks0108_SimClearStats();
+    ks0108_Flush(&GLCD);
+    report("Flush (drawing)");
+    failed |= check("Draw");
+
+    ks0108_SelectFont(&GLCD, System5x7, BLACK);
+    ks0108_FillRect(&GLCD, 0, 8, DISPLAY_WIDTH-1, 31, WHITE);
+    ks0108_Flush(&GLCD);
+    ks0108_SimClearStats();
+    ks0108_CursorToXY(&GLCD, 0, 8);
+    ks0108_Puts(&GLCD, "Hello, ks0108 world!");
+    ks0108_Flush(&GLCD);
+    report("Puts 20 chars");
+    ks0108_SimClearStats();
+    ks0108_SelectFont(&GLCD, Narrow5x7, BLACK);
+    ks0108_CursorToXY(&GLCD, 3, 19);
+    ks0108_Puts(&GLCD, "Hello, ks0108 world!");
+    ks0108_Flush(&GLCD);
+    report("Puts 20 chars (narrow)");
+    failed |= check("Puts");
+    // the 'H' of each line (the same columns in both fonts), straight from the font
+    for(x = 0; x < 5; x++) {
+        for(y = 0; y < 7; y++) {
+            page = (System5x7[6 + ('H'-' ')*5 + x] >> y) & 1;
+            if(ks0108_SimPixel(x, 8 + y) != page || ks0108_SimPixel(3 + x, 19 + y) != page) {
+                fprintf(stderr, "bench: Puts: wrong pixel in 'H' at %d,%d\n", x, y);
+                failed = 1;
+            }
+        }
+    }
+    if(ks0108_StringWidthCached(&GLCD, "Hello") != ks0108_StringWidth(&GLCD, "Hello")
+       || ks0108_StringWidth(&GLCD, "Hello") != 6+6+4+4+6) {
+        fprintf(stderr, "bench: StringWidth is wrong\n");
+        failed = 1;
+    }
+
+    // sprites: XOR twice puts everything back, masked copies clear their inside
+    memcpy(saved, GLCD.buffer, sizeof(saved));
+    ks0108_SimClearStats();
+    for(x = -5; x < DISPLAY_WIDTH; x += 13)
+        ks0108_Blit(&GLCD, sprite, x, x/3 - 4, ROP_XOR);
+    ks0108_Flush(&GLCD);
+    report("Blit x11 (XOR)");
+    failed |= check("Blit XOR");
+    for(x = -5; x < DISPLAY_WIDTH; x += 13)
+        ks0108_Blit(&GLCD, sprite, x, x/3 - 4, ROP_XOR);
+    if(memcmp(saved, GLCD.buffer, sizeof(saved)) != 0) {
+        fprintf(stderr, "bench: Blit: XOR twice changed the buffer\n");
+        failed = 1;
+    }
+    ks0108_Flush(&GLCD);
+    ks0108_SimClearStats();
+    ks0108_BlitMasked(&GLCD, sprite, spriteMask, 61, 27, ROP_COPY);
+    ks0108_Flush(&GLCD);
+    report("BlitMasked 10x12");
+    failed |= check("BlitMasked");
+    for(x = 0; x < 10; x++) {
+        for(y = 0; y < 12; y++) {
+            page = GLCD.startline + 27 + y;
+            if(((spriteMask[2 + (y/8)*10 + x] >> (y%8)) & 1)
+               && ((GLCD.buffer[page/8][GLCD.startcol + 61 + x] >> (page%8)) & 1) != ((sprite[2 + (y/8)*10 + x] >> (y%8)) & 1)) {
+                fprintf(stderr, "bench: BlitMasked: wrong pixel at %d,%d\n", x, y);
+                failed = 1;
+            }
+        }
+    }
+
+    // background flush: a fake timer tick sends a few transactions at a time
+    // while drawing carries on in between
+    GLCD.FlushDone = FlushDone;
+    ks0108_FillRect(&GLCD, 0, 0, DISPLAY_WIDTH-1, DISPLAY_HEIGHT-1, WHITE);
+    ks0108_SelectFont(&GLCD, System5x7, BLACK);
+    ks0108_CursorToXY(&GLCD, 14, 2);
+    ks0108_Puts(&GLCD, "background flush");
+    ks0108_SimClearStats();
+    ticks = 0;
+    worst = 0;
+    do {
+        enables = ks0108_SimStat.enables;
+        page = ks0108_FlushStep(&GLCD, 16);
+        if(ks0108_SimStat.enables - enables > worst)
+            worst = ks0108_SimStat.enables - enables;
+        if(ticks < 40)
+            ks0108_DrawLine(&GLCD, 20 + ticks, 20, 100 - ticks, 60, BLACK);
+        ticks++;
+    } while(page || ks0108_FlushPending(&GLCD));
+    report("FlushStep 16 per tick");
+    printf("%-24s ticks %d  worst tick %lu enables  done %d\n", "FlushStep 16 per tick", ticks, worst, flushesDone);
+    failed |= check("FlushStep");
+    ks0108_FlushStep(&GLCD, 16);
+    if(flushesDone != 1) {
+        fprintf(stderr, "bench: FlushDone was called %d times\n", flushesDone);
+        failed = 1;
+    }
+    GLCD.FlushDone = NULL;
+
+    // display list: a scribble of dots in any order changes each byte once and
+    // ends up the same as drawing the dots one by one
+    ks0108_Flush(&GLCD);
+    memcpy(saved, GLCD.buffer, sizeof(saved));
+    for(x = 0; x < 300; x++)
+        ks0108_DrawDot(&GLCD, 40 + (x*7)%23, 30 + (x*13)%11, x%5 ? BLACK : WHITE);
+    ks0108_FillRect(&GLCD, 70, 30, 5, 5, BLACK);
+    ks0108_DrawDot(&GLCD, 72, 32, WHITE);
+    memcpy(drawn, GLCD.buffer, sizeof(drawn));
+    memcpy(GLCD.buffer, saved, sizeof(saved));
+    ks0108_ListInit(&list, &GLCD);
+    for(x = 0; x < 300; x++)
+        ks0108_ListDot(&list, 40 + (x*7)%23, 30 + (x*13)%11, x%5 ? BLACK : WHITE);
+    ks0108_ListRect(&list, 70, 30, 5, 5, BLACK);
+    ks0108_ListDot(&list, 72, 32, WHITE);
+    ks0108_ListRun(&list);
+    if(memcmp(drawn, GLCD.buffer, sizeof(drawn)) != 0) {
+        fprintf(stderr, "bench: ListRun drew something else than the same calls one by one\n");
+        failed = 1;
+    }
+    ks0108_SimClearStats();
+    ks0108_Flush(&GLCD);
+    report("ListRun 300 dots + rect");
+    failed |= check("ListRun");
+
+    // strokes: sparse samples of a fast scribble joined up. A hairline has to
+    // draw what DrawLine does, a wide brush the squares stamped at every pixel
+    // of those lines, and each frame sends the bytes it touched once
+    for(x = 0; x <= 4; x += 4) {
+        ks0108_FillRect(&GLCD, 0, 0, DISPLAY_WIDTH-1, DISPLAY_HEIGHT-1, WHITE);
+        ks0108_Flush(&GLCD);
+        memcpy(saved, GLCD.buffer, sizeof(saved));
+        for(steps = 1; steps < 16; steps++)
+            BrushLine(strokePoints[steps-1].x, strokePoints[steps-1].y,
+                      strokePoints[steps].x, strokePoints[steps].y, x + 1);
+        memcpy(drawn, GLCD.buffer, sizeof(drawn));
+        memcpy(GLCD.buffer, saved, sizeof(saved));
+        ks0108_StrokeInit(&stroke, &GLCD);
+        ks0108_StrokeBrush(&stroke, x + 1, BLACK);
+        ks0108_SimClearStats();
+        for(steps = 0; steps < 16; steps += 4) {                // a frame per 4 samples
+            ks0108_StrokeBatch(&stroke, strokePoints + steps, 4);
+            ks0108_StrokeCommit(&stroke);
+            ks0108_Flush(&GLCD);
+        }
+        ks0108_StrokeBatch(&stroke, strokePoints + 16, 1);
+        if(memcmp(drawn, GLCD.buffer, sizeof(drawn)) != 0) {
+            fprintf(stderr, "bench: a stroke of width %d drew something else than its lines\n", x + 1);
+            failed = 1;
+        }
+        report(x ? "Stroke width 5" : "Stroke hairline");
+        failed |= check("Stroke");
+    }
+
+    // smooth scrolling: pan down and right a pixel at a time, with a fixed bus
+    // budget per frame, taking the next step once the last one is on the glass
+    // (with a canvas as wide as the screen, only down)
+    for(x = 0; x < CANVAS_WIDTH; x += 16)
+        ks0108_DrawVertLine(&GLCD, x - GLCD.startcol, -GLCD.startline, XPAGES*SCREENS*8, BLACK);
+    ks0108_SetViewport(&GLCD, 0, 0);
+    ks0108_Flush(&GLCD);
+    ks0108_SimClearStats();
+    ticks = 0;
+    worst = 0;
+    for(steps = 0; steps < 24 || ks0108_FlushPending(&GLCD); ticks++) {
+        enables = ks0108_SimStat.enables;
+        if(!ks0108_FlushPending(&GLCD) && steps < 24) {
+            failed |= check("SetViewport");
+            ks0108_SetViewport(&GLCD, ks0108_LeftColumn(&GLCD) + 1, ks0108_TopLine(&GLCD) + 1);
+            steps++;
+        }
+        ks0108_FlushStep(&GLCD, 256);
+        if(ks0108_SimStat.enables - enables > worst)
+            worst = ks0108_SimStat.enables - enables;
+    }
+    report("SetViewport +1,+1 x24");
+    printf("%-24s frames %d  worst frame %lu enables  at %d,%d\n", "SetViewport +1,+1 x24", ticks, worst,
+           ks0108_LeftColumn(&GLCD), ks0108_TopLine(&GLCD));
+    failed |= check("SetViewport");
+    if(ks0108_TopLine(&GLCD) != 24 || ks0108_LeftColumn(&GLCD) != (CANVAS_WIDTH > DISPLAY_WIDTH ? 24 : 0)) {
+        fprintf(stderr, "bench: SetViewport ended up at %d,%d\n", ks0108_LeftColumn(&GLCD), ks0108_TopLine(&GLCD));
+        failed = 1;
+    }
+
+#ifdef KS0108_TILED
+    // a tiled canvas: draw something small and different on every screen on
+    // the way down, then visit them again out of order
+    ks0108_SetStartLine(&GLCD, 0);
+    ks0108_ClearScreen(&GLCD, WHITE);
+    ks0108_SelectFont(&GLCD, System5x7, BLACK);
+    for(page = 0; page < CANVAS_SCREENS; page++) {
+        ks0108_SetStartLine(&GLCD, page*DISPLAY_HEIGHT);
+        ks0108_CursorToXY(&GLCD, 20 + page, 8);
+        ks0108_PrintNumber(&GLCD, page);
+        ks0108_DrawCircle(&GLCD, 64 + page*3, 40, 5 + page/4, BLACK);
+        ks0108_Flush(&GLCD);
+        hashes[page] = glass();
+    }
+    printf("%-24s window %d  pool %u of %u bytes\n", "Tiled canvas", GLCD.windowTop, GLCD.poolUsed, KS0108_TILE_POOL);
+    for(page = 0; page < CANVAS_SCREENS; page++) {
+        y = (page*7) % CANVAS_SCREENS;
+        ks0108_SimClearStats();
+        ks0108_SetStartLine(&GLCD, y*DISPLAY_HEIGHT);
+        ks0108_Flush(&GLCD);
+        if(page == 1)
+            report("Scroll 7 screens (tiled)");
+        failed |= check("tiled canvas");
+        if(glass() != hashes[y]) {
+            fprintf(stderr, "bench: tiled canvas: screen %d came back different\n", y);
+            failed = 1;
+        }
+    }
+    // noise doesn't compress: the window stops sliding when the pool is full
+    ks0108_SetStartLine(&GLCD, 0);
+    for(page = 0; page < CANVAS_SCREENS; page++) {
+        for(y = 0; y < DISPLAY_HEIGHT; y += 2)
+            for(x = 0; x < DISPLAY_WIDTH; x += 1 + (x*y) % 3)
+                ks0108_DrawDot(&GLCD, x, y, BLACK);
+        ks0108_Scroll(&GLCD, DISPLAY_HEIGHT);
+        failed |= check("tiled canvas (pool full)");
+    }
+    printf("%-24s top line %d  pool %u of %u bytes\n", "Tiled canvas (noise)", ks0108_TopLine(&GLCD),
+           GLCD.poolUsed, KS0108_TILE_POOL);
+    ks0108_SetStartLine(&GLCD, 0);                  // it can still go back up
+    ks0108_Flush(&GLCD);
+    failed |= check("tiled canvas (back to the top)");
+    if(ks0108_TopLine(&GLCD) != 0) {
+        fprintf(stderr, "bench: tiled canvas: stuck at line %d\n", ks0108_TopLine(&GLCD));
+        failed = 1;
+    }
+#endif
+
+    // a paint session: the samples go through the stroke engine like in
+    // paint.c, with Timer A flushing 16 transactions every 1 ms (two ticks per
+    // sample) and the strokes committed whenever the last frame is out
+    ks0108_SetViewport(&GLCD, 0, 0);
+    ks0108_ClearScreen(&GLCD, WHITE);
+    ks0108_StrokeInit(&stroke, &GLCD);
+    ks0108_SimClearStats();
+#ifdef KS0108_TRACE
+    ks0108_TraceClear();
+#endif
+    ticks = 0;
+    worst = 0;
+    y = -1;                                         // where a scroll drag was (-1 = not dragging)
+    for(steps = 0; steps < SESSION_SAMPLES; steps++) {
+        sample = &session[steps];
+        if(sample->op == 'u') {
+            ks0108_StrokeLift(&stroke);
+            y = -1;
+        } else if(sample->op == 's') {
+            if(y >= 0 && y != sample->y) {
+                ks0108_StrokeCommit(&stroke);
+                ks0108_SetStartLine(&GLCD, ks0108_TopLine(&GLCD) + y - sample->y);
+            }
+            y = sample->y;
+        } else {
+            ks0108_StrokeBrush(&stroke, sample->op == 'e' ? 12 : 1, sample->op == 'e' ? WHITE : BLACK);
+            ks0108_StrokeTo(&stroke, sample->x, sample->y);
+        }
+        if(!ks0108_FlushPending(&GLCD))
+            ks0108_StrokeCommit(&stroke);
+        for(x = 0; x < 2; x++, ticks++)
+            if((enables = PaintTick()) > worst)
+                worst = enables;
+    }
+    ks0108_StrokeCommit(&stroke);                   // the last frame
+    for(; ks0108_FlushPending(&GLCD); ticks++)
+        if((enables = PaintTick()) > worst)
+            worst = enables;
+    report("Paint session replay");
+#ifdef KS0108_TRACE
+    if(!(traceFile = fopen("trace.bin", "wb"))) {
+        fprintf(stderr, "bench: can't write trace.bin\n");
+        return 1;
+    }
+    ks0108_TraceDump(TracePut);
+    fclose(traceFile);
+#endif
+    printf("%-24s samples %d  ticks %d  worst tick %lu enables\n", "Paint session replay",
+           SESSION_SAMPLES, ticks, worst);
+    failed |= check("Paint session replay");
+    if(ks0108_TopLine(&GLCD) != 40) {
+        fprintf(stderr, "bench: the paint session scrolled to line %d\n", ks0108_TopLine(&GLCD));
+        failed = 1;
+    }
+
+    // a chip that never comes ready: no profile, and no write-only mode without one
+    ks0108_SimBusyCycles = 60000;
+    if(ks0108_Calibrate(&GLCD) || GLCD.BusyDelay != 0 || ks0108_SetWriteOnly(&GLCD, 1)) {
+        fprintf(stderr, "bench: Calibrate made a profile for a chip that is always busy\n");
+        failed = 1;
+    }
+
+    // a slow panel: the calibrated profile has to cover its busy time without polling
+    ks0108_SimBusyCycles = 400;
+    if(!ks0108_Calibrate(&GLCD) || !ks0108_SetWriteOnly(&GLCD, 1)) {
+        fprintf(stderr, "bench: Calibrate failed on the slow panel\n");
+        failed = 1;
+    }
+    ks0108_Scroll(&GLCD, -40);
+    ks0108_ForgetGlass(&GLCD);                      // send every byte, even with the glass mirror
+    ks0108_SimClearStats();
+    ks0108_DumpBuffer(&GLCD);
+    report("DumpBuffer (slow panel)");
+    printf("%-24s BusyDelay %u\n", "Calibrate (slow panel)", GLCD.BusyDelay);
+    if(ks0108_SimStat.lostWrites || ks0108_SimStat.statusReads) {
+        fprintf(stderr, "bench: write-only mode polled or lost writes\n");
+        failed = 1;
+    }
+    failed |= check("DumpBuffer (slow panel)");
+
+    ks0108_SimBusyCycles = 64;
+    ks0108_SetWriteOnly(&GLCD, 0);
+    ks0108_Calibrate(&GLCD);
+    ks0108_SetWriteOnly(&GLCD, 1);
+    ks0108_SimClearStats();
+    ks0108_SetDot(&GLCD, 100, 50, BLACK);
+    report("SetDot (write-only)");
+    ks0108_ForgetGlass(&GLCD);
+    ks0108_SimClearStats();
+    ks0108_DumpBuffer(&GLCD);
+    report("DumpBuffer (write-only)");
+    failed |= check("write-only") || ks0108_SimStat.lostWrites;
+
+#ifdef KS0108_MULTIPANEL
+    // three panels on one bus (EN, EN2 and EN3): redraw them one after the
+    // other, then all at once with FlushPanels. Where the chips are slower
+    // than the bus that has to take well under three times one panel.
+    ks0108_PanelPins(&pins, PIN_BIT(EN2));
+    ks0108_InitPanel(&second, &pins, 0);
+    ks0108_PanelPins(&pins, PIN_BIT(EN3));
+    ks0108_InitPanel(&third, &pins, 1);
+    for(x = 0; x < 3; x++)
+        for(page = 0; page < XPAGES*SCREENS; page++)
+            for(y = 0; y < CANVAS_WIDTH; y++)
+                panels[x]->buffer[page][y] = (uint8_t)(page*37 + y*(11 + x*2)) ^ (y & (8 << x) ? 0x5A : 0);
+    for(steps = 0; steps < 3; steps++) {
+        ks0108_SimBusyCycles = steps ? 400 : 64;
+        for(x = 0; x < 3; x++) {
+            ks0108_SetWriteOnly(panels[x], 0);
+            ks0108_Calibrate(panels[x]);
+            if(steps == 2)
+                panels[x]->BusyDelay = 0;                   // poll the busy flag
+            ks0108_ForgetGlass(panels[x]);
+        }
+        ks0108_SimClearStats();
+        for(x = 0; x < 3; x++)
+            ks0108_DumpBuffer(panels[x]);
+        sprintf(label, "Dump 3 panels%s", steps == 0 ? "" : steps == 1 ? " (slow)" : " (polled)");
+        report(label);
+        serial = ks0108_SimStat.cycles;
+        for(x = 0; x < 3; x++) {
+            ks0108_ForgetGlass(panels[x]);
+            ks0108_Invalidate(panels[x]);
+        }
+        ks0108_SimClearStats();
+        ks0108_FlushPanels(panels, 3);
+        sprintf(label, "FlushPanels 3%s", steps == 0 ? "" : steps == 1 ? " (slow)" : " (polled)");
+        report(label);
+        printf("%-24s %.2f of the time one by one\n", label, (double)ks0108_SimStat.cycles / serial);
+        if(ks0108_SimStat.lostWrites || (steps && ks0108_SimStat.cycles*2 > serial)) {
+            fprintf(stderr, "bench: %s lost writes or took too long\n", label);
+            failed = 1;
+        }
+        for(x = 0; x < 3; x++) {
+            ks0108_SimPanel(x);
+            failed |= CheckPanel(panels[x], label);
+        }
+        ks0108_SimPanel(0);
+    }
+    ks0108_SimBusyCycles = 64;
+#endif
+
+    for(x = 0; x < budgetCount; x++) {
+        if(!budgets[x].used) {
+            fprintf(stderr, "bench: there is a budget for \"%s\" but no such scenario\n", budgets[x].label);
+            overBudget = 1;
+        }
+    }
+    return failed || overBudget;
+}
@@ -0,0 +1,47 @@
+#ifndef KS0108_HOST_H
+#define KS0108_HOST_H
+
+/* ks0108_host.h
+ * host (PC) counterpart of ks0108_msp430.h
+ *
+ * The pin assignments are the same as on the MSP430 so that ks0108.c compiles
+ * unchanged, but LCD_CMD_PORT and the data port are variables owned by the bus
+ * model in ks0108_sim.c, and the pin functions tell the model when they change.
+ */
+
+#include "msp.h"
+
+/*********************************************************/
+/*  Configuration for assigning LCD bits to model pins   */
+/*********************************************************/
+
+// command pins
+#define LCD_CMD_PORT        P3OUT       // port on which the command pins reside
+#define LCD_CMD_DIR         P3DIR       // and its direction register
+#define CSEL1               pp(LCD_CMD_PORT,3)      // chip select 1
+#define CSEL2               pp(LCD_CMD_PORT,4)      // chip select 2
+#define R_W                 pp(LCD_CMD_PORT,1)      // read/write
+#define D_I                 pp(LCD_CMD_PORT,0)      // D/I (also R_S in the docs)
+#define EN                  pp(LCD_CMD_PORT,2)      // enable bit
+#define RESET               pp(LCD_CMD_PORT,6)     // reset bit
+#define EN2                 pp(LCD_CMD_PORT,5)      // enable bits of more panels on the same bus
+#define EN3                 pp(LCD_CMD_PORT,7)      // (KS0108_MULTIPANEL, see ks0108_PanelPins)
+
+#undef LCD_DATA_NIBBLES // the model only has a single 8-bit data port
+#define LCD_DATA_LOW_NBL   7   // port for low nibble
+#define LCD_DATA_HIGH_NBL  LCD_DATA_LOW_NBL   // port for high nibble
+
+// convenience functions for pulling pins high/low
+// (implemented in ks0108_sim.c so the model sees every edge on EN)
+void fastWriteHigh(uint8_t port, uint8_t pin);
+void fastWriteLow(uint8_t port, uint8_t pin);
+void fastWritePins(uint8_t mask, uint8_t bits);
+
+// the instrumentation (KS0108_TRACE) times things by the model's clock
+#define KS0108_TRACE_CLOCK32    ks0108_SimClock()
+#define KS0108_TRACE_HZ         8000000UL
+
+// the model's select lines are wired straight (see ks0108_sim.c)
+#define CHIPSELECT(chip) (DISPLAY_WIDTH/CHIP_WIDTH == 2 ? (chip) + 1 : (chip))
+
+#endif
@@ -0,0 +1,265 @@
+/* ks0108_sim.c
+ * behavioural model of the ks0108 panel bus (see ks0108_sim.h)
+ *
+ * The model only acts on edges of the EN pin, like the real controllers:
+ *  - while EN is high with R/W high, the data port shows the status register
+ *    (D/I low) or the output register (D/I high)
+ *  - on the falling edge of EN an instruction or data byte is latched (R/W low),
+ *    or the output register is reloaded from RAM (R/W high, D/I high) -- this is
+ *    why the first read after an address change returns stale data
+ *  - reads and writes advance the column counter, which wraps at CHIP_WIDTH
+ *  - after every access a controller stays busy for ks0108_SimBusyCycles;
+ *    anything written to it in that time is ignored and counted as lost
+ *  - with KS0108_MULTIPANEL there are KS0108_SIM_PANELS panels on the bus,
+ *    each with its own enable pin (EN, EN2, EN3) and the rest shared
+ *
+ * Time is estimated MSP430 cycles at 8 MHz, advanced by the pin, port and
+ * delay hooks that the driver calls.
+ */
+
+#include <string.h>
+
+#include "ks0108.h"
+#include "ks0108_sim.h"
+
+// estimated cost of each hook, in MSP430 cycles
+#define PIN_CYCLES      5   // bis.b/bic.b on the command port
+#define PORT_CYCLES     8   // data port direction and output writes around each transaction
+#define POLL_CYCLES     6   // one pass of the busy flag loop in ks0108_WaitReady
+#define MS_CYCLES    8000   // delay(1) at 8 MHz
+
+#define CHIPS (DISPLAY_WIDTH/CHIP_WIDTH)
+
+// the enable pin of each panel (KS0108_MULTIPANEL), the rest of the bus is shared
+static const uint8_t panelEnable[KS0108_SIM_PANELS] = {
+    PIN_BIT(EN),
+#ifdef KS0108_MULTIPANEL
+    PIN_BIT(EN2), PIN_BIT(EN3)
+#endif
+};
+
+uint8_t P3OUT, P3DIR, P7OUT, P7DIR;
+uint16_t ks0108_SimInterrupts = 1;
+
+ks0108_SimStats ks0108_SimStat;
+static unsigned long elapsed;   // cycles before the last ClearStats
+unsigned int ks0108_SimBusyCycles = 64;   // 8 us
+
+typedef struct {
+    uint8_t ram[8][CHIP_WIDTH];
+    uint8_t page;           // X address (page) counter
+    uint8_t column;         // Y address (column) counter
+    uint8_t startline;      // display start line
+    uint8_t on;             // display on/off
+    uint8_t output;         // output register (what the next data read returns)
+    unsigned long busyUntil;
+} simChip;
+
+static simChip panels[KS0108_SIM_PANELS][CHIPS];
+static uint8_t enable[KS0108_SIM_PANELS];  // last seen state of each EN
+static uint8_t view;        // the panel that SimRam, SimPixel etc. look at
+
+// which controllers are listening to the current chip select lines
+static uint8_t selected(uint8_t chip) {
+    uint8_t cs = ((P3OUT & PIN_BIT(CSEL1)) ? 1 : 0) | ((P3OUT & PIN_BIT(CSEL2)) ? 2 : 0);
+#if (CHIPS == 2)
+    return (cs >> chip) & 1;        // one active high select line per controller
+#else
+    return cs == chip;              // select lines are decoded, 3 = nobody
+#endif
+}
+
+static void command(simChip *c, uint8_t cmd) {
+    if((cmd & 0xFE) == (LCD_OFF & 0xFE))
+        c->on = cmd & 1;
+    else if((cmd & 0xC0) == LCD_DISP_START)
+        c->startline = cmd & 0x3F;
+    else if((cmd & 0xF8) == LCD_SET_PAGE)
+        c->page = cmd & 0x07;
+    else if((cmd & 0xC0) == LCD_SET_ADD)
+        c->column = cmd & 0x3F;
+}
+
+// a panel's EN went low: latch whatever its selected controllers were told to do
+static void latch(simChip *chips) {
+    uint8_t chip, d_i, r_w;
+    simChip *c;
+
+    d_i = (P3OUT & PIN_BIT(D_I)) != 0;
+    r_w = (P3OUT & PIN_BIT(R_W)) != 0;
+    ks0108_SimStat.enables++;
+    ks0108_SimStat.cycles += PORT_CYCLES;
+    if(r_w && !d_i)                 // status reads have no side effects
+        return;
+    if(r_w)
+        ks0108_SimStat.reads++;
+    else if(d_i)
+        ks0108_SimStat.writes++;
+    else
+        ks0108_SimStat.commands++;
+
+    for(chip = 0; chip < CHIPS; chip++) {
+        if(!selected(chip))
+            continue;
+        c = &chips[chip];
+        if(!r_w && ks0108_SimStat.cycles < c->busyUntil) {
+            ks0108_SimStat.lostWrites++;
+            continue;
+        }
+        if(r_w) {
+            c->output = c->ram[c->page][c->column];
+            c->column = (c->column + 1) % CHIP_WIDTH;
+        } else if(d_i) {
+            c->ram[c->page][c->column] = P7OUT;
+            c->column = (c->column + 1) % CHIP_WIDTH;
+        } else {
+            command(c, P7OUT);
+        }
+        c->busyUntil = ks0108_SimStat.cycles + ks0108_SimBusyCycles;
+    }
+}
+
+static void pins(void) {
+    uint8_t panel, en;
+
+    ks0108_SimStat.cycles += PIN_CYCLES;
+    for(panel = 0; panel < KS0108_SIM_PANELS; panel++) {
+        en = (P3OUT & panelEnable[panel]) != 0;
+        if(enable[panel] && !en)
+            latch(panels[panel]);
+        enable[panel] = en;
+    }
+}
+
+void fastWriteHigh(uint8_t port, uint8_t pin) {
+    SETBIT(LCD_CMD_PORT, pin);
+    pins();
+}
+
+void fastWriteLow(uint8_t port, uint8_t pin) {
+    CLRBIT(LCD_CMD_PORT, pin);
+    pins();
+}
+
+void fastWritePins(uint8_t mask, uint8_t bits) {
+    LCD_CMD_PORT = (LCD_CMD_PORT & ~mask) | bits;
+    pins();
+}
+
+uint8_t ks0108_SimReadPort(void) {
+    uint8_t panel, chip, data, drivers;
+    simChip *c;
+
+    for(panel = 0; panel < KS0108_SIM_PANELS && !enable[panel]; panel++)
+        ;
+    if(panel == KS0108_SIM_PANELS || !(P3OUT & PIN_BIT(R_W)) || P7DIR != 0x00)
+        return P7OUT;               // nobody is driving the pins
+
+    data = 0xFF;
+    drivers = 0;
+    for(panel = 0; panel < KS0108_SIM_PANELS; panel++) {
+        for(chip = 0; chip < CHIPS && enable[panel]; chip++) {
+            if(!selected(chip))
+                continue;
+            c = &panels[panel][chip];
+            drivers++;
+            if(P3OUT & PIN_BIT(D_I)) {
+                data &= c->output;
+            } else if(ks0108_SimStat.cycles < c->busyUntil) {
+                data &= LCD_BUSY_FLAG | (c->on ? 0 : 0x20);
+                ks0108_SimStat.busySpins++;
+            } else {
+                data &= c->on ? 0 : 0x20;
+            }
+        }
+    }
+    if(drivers > 1)
+        ks0108_SimStat.conflicts++;
+    if(!(P3OUT & PIN_BIT(D_I))) {
+        ks0108_SimStat.statusReads++;
+        ks0108_SimStat.cycles += POLL_CYCLES;
+    }
+    return data;
+}
+
+// calla, mov.w &ks0108_EnDelay, 4 cycles per pass of edloop, reta
+void EN_DELAY(void) {
+    ks0108_SimStat.cycles += 11 + 4*ks0108_EnDelay;
+}
+
+void delay(unsigned int ms) {
+    ks0108_SimStat.cycles += (unsigned long)ms * MS_CYCLES;
+}
+
+void pinMode(unsigned char port, unsigned char pin, pin_mode mode) {
+    // the model has no pin directions on the command port
+}
+
+void ks0108_SimReset(void) {
+    memset(panels, 0, sizeof(panels));
+    P3OUT = P3DIR = P7OUT = P7DIR = 0;
+    memset(enable, 0, sizeof(enable));
+    view = 0;
+    ks0108_SimClearStats();
+}
+
+void ks0108_SimClearStats(void) {
+    uint8_t panel, chip;
+    simChip *c;
+
+    // keep the busy timers relative to the new clock
+    for(panel = 0; panel < KS0108_SIM_PANELS; panel++) {
+        for(chip = 0; chip < CHIPS; chip++) {
+            c = &panels[panel][chip];
+            if(c->busyUntil > ks0108_SimStat.cycles)
+                c->busyUntil -= ks0108_SimStat.cycles;
+            else
+                c->busyUntil = 0;
+        }
+    }
+    elapsed += ks0108_SimStat.cycles;
+    memset(&ks0108_SimStat, 0, sizeof(ks0108_SimStat));
+}
+
+uint32_t ks0108_SimClock(void) {
+    return elapsed + ks0108_SimStat.cycles;
+}
+
+void ks0108_SimPrintStats(FILE *f, const char *label) {
+    ks0108_SimStats *s = &ks0108_SimStat;
+
+    fprintf(f, "%-24s en %6lu  cmd %6lu  wr %6lu  rd %5lu  status %6lu  spin %5lu  lost %lu  cycles %8lu\n",
+            label, s->enables, s->commands, s->writes, s->reads, s->statusReads,
+            s->busySpins, s->lostWrites, s->cycles);
+}
+
+void ks0108_SimPanel(uint8_t panel) {
+    view = panel < KS0108_SIM_PANELS ? panel : 0;
+}
+
+uint8_t ks0108_SimRam(uint8_t chip, uint8_t page, uint8_t column) {
+    return panels[view][chip].ram[page][column];
+}
+
+uint8_t ks0108_SimStartLine(uint8_t chip) {
+    return panels[view][chip].startline;
+}
+
+uint8_t ks0108_SimPixel(uint8_t x, uint8_t y) {
+    simChip *c = &panels[view][x/CHIP_WIDTH];
+    uint8_t row = (c->startline + y) % DISPLAY_HEIGHT;
+
+    if(!c->on)
+        return 0;
+    return (c->ram[row/8][x%CHIP_WIDTH] >> (row%8)) & 1;
+}
+
+void ks0108_SimPrint(FILE *f) {
+    uint8_t x, y;
+
+    for(y = 0; y < DISPLAY_HEIGHT; y++) {
+        for(x = 0; x < DISPLAY_WIDTH; x++)
+            fputc(ks0108_SimPixel(x, y) ? '#' : '.', f);
+        fputc('\n', f);
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef KS0108_SIM_H
+#define KS0108_SIM_H
+
+/* ks0108_sim.h
+ * behavioural model of the ks0108 panel bus, for building the library on a PC
+ *
+ * msp.h includes this instead of the MSP430 device header when KS0108_HOST is
+ * defined. It provides stand-ins for the registers the driver touches and a
+ * model of one ks0108 controller per CHIP_WIDTH columns, with page/column
+ * address counters, busy flag, display start line and the dummy read that the
+ * real chips need after an address change. Every bus transaction is counted so
+ * that changes to the driver can be measured without hardware.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+
+// panels on the bus (KS0108_MULTIPANEL: one for each enable pin in ks0108_host.h)
+#ifdef KS0108_MULTIPANEL
+#define KS0108_SIM_PANELS 3
+#else
+#define KS0108_SIM_PANELS 1
+#endif
+
+// stand-in registers (LCD_CMD_PORT and the data port in ks0108_host.h)
+extern uint8_t P3OUT;                   // command pins, watched through fastWriteHigh/Low/Pins
+extern uint8_t P3DIR;                   // their direction (not modelled)
+extern uint8_t P7OUT;                   // data port output latch
+extern uint8_t P7DIR;                   // data port direction
+#define P7IN ks0108_SimReadPort()       // data port pins, driven by the selected controller(s)
+extern uint16_t ks0108_SimInterrupts;  // the interrupt enable, as far as KS0108_LOCK is concerned (the PC has none)
+
+uint8_t ks0108_SimReadPort(void);
+
+// running totals, cleared by ks0108_SimClearStats
+typedef struct {
+    unsigned long enables;      // enable pulses (one per bus transaction)
+    unsigned long commands;     // instructions written (D/I low, R/W low)
+    unsigned long writes;       // display data bytes written
+    unsigned long reads;        // display data bytes read (including dummy reads)
+    unsigned long statusReads;  // status register reads (every pass of a busy poll)
+    unsigned long busySpins;    // status reads that found a controller busy
+    unsigned long lostWrites;   // writes sent to a controller while it was busy (the chip ignores them)
+    unsigned long conflicts;    // reads with more than one controller driving the bus
+    unsigned long cycles;       // estimated MSP430 cycles spent on the bus at 8 MHz
+} ks0108_SimStats;
+
+extern ks0108_SimStats ks0108_SimStat;
+
+extern unsigned int ks0108_SimBusyCycles;   // how long a controller stays busy after each access
+
+void ks0108_SimReset(void);
+    // power-on state: controllers off, RAM and counters cleared
+void ks0108_SimClearStats(void);
+    // zero the counters (the model state is kept)
+void ks0108_SimPrintStats(FILE *f, const char *label);
+    // one line of counters, tagged with label
+uint32_t ks0108_SimClock(void);
+    // cycles since the program started (ClearStats doesn't reset it)
+
+void ks0108_SimPanel(uint8_t panel);
+    // the panel that the functions below look at (0, the one at EN, until told otherwise)
+uint8_t ks0108_SimRam(uint8_t chip, uint8_t page, uint8_t column);
+    // read controller RAM directly, without going through the bus
+uint8_t ks0108_SimStartLine(uint8_t chip);
+    // display start line register of a controller
+uint8_t ks0108_SimPixel(uint8_t x, uint8_t y);
+    // what the glass shows at screen x/y (start line applied), 1 = dark
+void ks0108_SimPrint(FILE *f);
+    // ASCII picture of the glass
+
+#endif
@@ -0,0 +1,83 @@
+/* session.h
+ * a scripted session of examples/paint.c, replayed by bench.c: the touch
+ * samples as the main loop sees them after calibration (screen coordinates),
+ * one every 2 ms like ADC12_ISR queues them. 'p' is the pencil, 'e' the
+ * eraser, 's' a drag in scroll mode and 'u' the pen going up.
+ */
+
+typedef struct {
+    uint8_t x;
+    uint8_t y;
+    char    op;
+} sessionSample;
+
+#define SESSION_SAMPLES ((int)(sizeof(session)/sizeof(session[0])))
+
+static const sessionSample session[521] = {
+    {24, 36, 'p'}, {24, 38, 'p'}, {24, 40, 'p'}, {24, 43, 'p'}, {24, 45, 'p'}, {23, 46, 'p'}, {23, 48, 'p'}, {22, 49, 'p'},
+    {21, 51, 'p'}, {20, 51, 'p'}, {19, 52, 'p'}, {18, 52, 'p'}, {17, 52, 'p'}, {16, 52, 'p'}, {15, 51, 'p'}, {14, 51, 'p'},
+    {13, 49, 'p'}, {13, 48, 'p'}, {12, 47, 'p'}, {12, 45, 'p'}, {12, 43, 'p'}, {12, 41, 'p'}, {13, 39, 'p'}, {13, 38, 'p'},
+    {14, 36, 'p'}, {15, 34, 'p'}, {16, 32, 'p'}, {17, 31, 'p'}, {19, 30, 'p'}, {20, 29, 'p'}, {22, 28, 'p'}, {24, 28, 'p'},
+    {26, 28, 'p'}, {28, 28, 'p'}, {29, 28, 'p'}, {31, 29, 'p'}, {33, 30, 'p'}, {35, 31, 'p'}, {36, 32, 'p'}, {37, 34, 'p'},
+    {38, 36, 'p'}, {39, 38, 'p'}, {40, 40, 'p'}, {41, 42, 'p'}, {41, 44, 'p'}, {41, 46, 'p'}, {41, 48, 'p'}, {41, 49, 'p'},
+    {40, 51, 'p'}, {40, 52, 'p'}, {39, 54, 'p'}, {38, 54, 'p'}, {37, 55, 'p'}, {36, 55, 'p'}, {35, 56, 'p'}, {34, 55, 'p'},
+    {33, 55, 'p'}, {32, 54, 'p'}, {31, 53, 'p'}, {30, 51, 'p'}, {29, 50, 'p'}, {29, 48, 'p'}, {29, 46, 'p'}, {29, 44, 'p'},
+    {29, 42, 'p'}, {29, 40, 'p'}, {30, 38, 'p'}, {30, 35, 'p'}, {31, 33, 'p'}, {32, 31, 'p'}, {34, 30, 'p'}, {35, 28, 'p'},
+    {37, 27, 'p'}, {39, 26, 'p'}, {40, 25, 'p'}, {42, 24, 'p'}, {44, 24, 'p'}, {46, 24, 'p'}, {48, 25, 'p'}, {49, 25, 'p'},
+    {51, 26, 'p'}, {52, 27, 'p'}, {54, 29, 'p'}, {55, 30, 'p'}, {56, 32, 'p'}, {57, 34, 'p'}, {57, 35, 'p'}, {58, 37, 'p'},
+    {58, 39, 'p'}, {58, 41, 'p'}, {57, 42, 'p'}, {57, 44, 'p'}, {56, 45, 'p'}, {56, 46, 'p'}, {55, 47, 'p'}, {54, 47, 'p'},
+    {53, 48, 'p'}, {52, 48, 'p'}, {51, 47, 'p'}, {50, 47, 'p'}, {49, 46, 'p'}, {48, 45, 'p'}, {47, 43, 'p'}, {46, 42, 'p'},
+    {46, 40, 'p'}, {45, 38, 'p'}, {45, 36, 'p'}, {45, 34, 'p'}, {46, 32, 'p'}, {46, 29, 'p'}, {47, 27, 'p'}, {48, 25, 'p'},
+    {49, 23, 'p'}, {50, 22, 'p'}, {52, 20, 'p'}, {53, 19, 'p'}, {55, 18, 'p'}, {57, 17, 'p'}, {59, 17, 'p'}, {60, 16, 'p'},
+    {62, 17, 'p'}, {64, 17, 'p'}, {66, 18, 'p'}, {67, 19, 'p'}, {69, 20, 'p'}, {70, 22, 'p'}, {71, 23, 'p'}, {72, 25, 'p'},
+    {73, 27, 'p'}, {74, 29, 'p'}, {74, 31, 'p'}, {74, 33, 'p'}, {74, 35, 'p'}, {74, 37, 'p'}, {74, 39, 'p'}, {73, 40, 'p'},
+    {72, 42, 'p'}, {72, 43, 'p'}, {71, 44, 'p'}, {70, 44, 'p'}, {68, 44, 'p'}, {67, 44, 'p'}, {66, 44, 'p'}, {65, 44, 'p'},
+    {64, 43, 'p'}, {64, 42, 'p'}, {63, 40, 'p'}, {62, 39, 'p'}, {62, 37, 'p'}, {62, 36, 'p'}, {62, 34, 'p'}, {62, 32, 'p'},
+    {63, 30, 'p'}, {63, 28, 'p'}, {64, 26, 'p'}, {65, 25, 'p'}, {67, 23, 'p'}, {68, 22, 'p'}, {70, 21, 'p'}, {71, 20, 'p'},
+    {73, 20, 'p'}, {75, 20, 'p'}, {77, 20, 'p'}, {79, 20, 'p'}, {80, 21, 'p'}, {82, 22, 'p'}, {84, 23, 'p'}, {85, 24, 'p'},
+    {87, 26, 'p'}, {88, 28, 'p'}, {89, 30, 'p'}, {90, 32, 'p'}, {90, 34, 'p'}, {91, 37, 'p'}, {91, 39, 'p'}, {91, 41, 'p'},
+    {91, 43, 'p'}, {90, 45, 'p'}, {90, 47, 'p'}, {89, 49, 'p'}, {88, 50, 'p'}, {87, 51, 'p'}, {86, 52, 'p'}, {85, 52, 'p'},
+    {84, 52, 'p'}, {83, 52, 'p'}, {82, 52, 'p'}, {81, 51, 'p'}, {80, 50, 'p'}, {80, 49, 'p'}, {79, 48, 'p'}, {79, 46, 'p'},
+    {79, 44, 'p'}, {79, 43, 'p'}, {79, 41, 'p'}, {79, 39, 'p'}, {80, 37, 'p'}, {81, 35, 'p'}, {82, 34, 'p'}, {83, 32, 'p'},
+    {85, 31, 'p'}, {86, 30, 'p'}, {88, 29, 'p'}, {89, 28, 'p'}, {91, 28, 'p'}, {93, 28, 'p'}, {95, 28, 'p'}, {97, 28, 'p'},
+    {98, 29, 'p'}, {100, 30, 'p'}, {102, 31, 'p'}, {103, 33, 'p'}, {104, 35, 'p'}, {105, 36, 'p'}, {106, 38, 'p'}, {107, 40, 'p'},
+    {107, 42, 'p'}, {108, 44, 'p'}, {108, 46, 'p'}, {108, 48, 'p'}, {107, 50, 'p'}, {107, 51, 'p'}, {106, 53, 'p'}, {105, 54, 'p'},
+    {104, 55, 'p'}, {103, 55, 'p'}, {102, 56, 'p'}, {101, 55, 'p'}, {100, 55, 'p'}, {99, 54, 'p'}, {98, 54, 'p'}, {97, 52, 'p'},
+    {97, 51, 'p'}, {96, 49, 'p'}, {96, 47, 'p'}, {95, 45, 'p'}, {95, 43, 'p'}, {96, 41, 'p'}, {96, 39, 'p'}, {97, 37, 'p'},
+    {97, 35, 'p'}, {98, 33, 'p'}, {100, 31, 'p'}, {101, 29, 'p'}, {102, 28, 'p'}, {104, 26, 'p'}, {106, 25, 'p'}, {108, 25, 'p'},
+    {109, 24, 'p'}, {111, 24, 'p'}, {113, 24, 'p'}, {115, 25, 'p'}, {117, 26, 'p'}, {118, 27, 'p'}, {120, 28, 'p'}, {121, 29, 'p'},
+    {122, 31, 'p'}, {123, 32, 'p'}, {124, 34, 'p'}, {124, 36, 'p'}, {0, 0, 'u'}, {16, 50, 'p'}, {17, 51, 'p'}, {18, 52, 'p'},
+    {19, 53, 'p'}, {20, 54, 'p'}, {21, 54, 'p'}, {22, 55, 'p'}, {24, 56, 'p'}, {25, 57, 'p'}, {26, 58, 'p'}, {27, 57, 'p'},
+    {28, 56, 'p'}, {29, 55, 'p'}, {30, 54, 'p'}, {31, 54, 'p'}, {32, 53, 'p'}, {33, 52, 'p'}, {34, 51, 'p'}, {35, 50, 'p'},
+    {36, 51, 'p'}, {38, 52, 'p'}, {39, 53, 'p'}, {40, 54, 'p'}, {41, 54, 'p'}, {42, 55, 'p'}, {43, 56, 'p'}, {44, 57, 'p'},
+    {45, 58, 'p'}, {46, 57, 'p'}, {47, 56, 'p'}, {48, 55, 'p'}, {49, 54, 'p'}, {51, 54, 'p'}, {52, 53, 'p'}, {53, 52, 'p'},
+    {54, 51, 'p'}, {55, 50, 'p'}, {56, 51, 'p'}, {57, 52, 'p'}, {58, 53, 'p'}, {59, 54, 'p'}, {60, 54, 'p'}, {61, 55, 'p'},
+    {62, 56, 'p'}, {63, 57, 'p'}, {65, 58, 'p'}, {66, 57, 'p'}, {67, 56, 'p'}, {68, 55, 'p'}, {69, 54, 'p'}, {70, 54, 'p'},
+    {71, 53, 'p'}, {72, 52, 'p'}, {73, 51, 'p'}, {74, 50, 'p'}, {75, 51, 'p'}, {76, 52, 'p'}, {77, 53, 'p'}, {79, 54, 'p'},
+    {80, 54, 'p'}, {81, 55, 'p'}, {82, 56, 'p'}, {83, 57, 'p'}, {84, 58, 'p'}, {85, 57, 'p'}, {86, 56, 'p'}, {87, 55, 'p'},
+    {88, 54, 'p'}, {89, 54, 'p'}, {90, 53, 'p'}, {92, 52, 'p'}, {93, 51, 'p'}, {94, 50, 'p'}, {95, 51, 'p'}, {96, 52, 'p'},
+    {97, 53, 'p'}, {98, 54, 'p'}, {99, 54, 'p'}, {100, 55, 'p'}, {101, 56, 'p'}, {102, 57, 'p'}, {103, 58, 'p'}, {104, 57, 'p'},
+    {106, 56, 'p'}, {107, 55, 'p'}, {108, 54, 'p'}, {109, 54, 'p'}, {110, 53, 'p'}, {111, 52, 'p'}, {112, 51, 'p'}, {0, 0, 'u'},
+    {40, 30, 'e'}, {40, 31, 'e'}, {41, 33, 'e'}, {41, 34, 'e'}, {42, 35, 'e'}, {42, 36, 'e'}, {43, 37, 'e'}, {43, 38, 'e'},
+    {43, 38, 'e'}, {44, 38, 'e'}, {44, 38, 'e'}, {45, 37, 'e'}, {45, 37, 'e'}, {46, 36, 'e'}, {46, 34, 'e'}, {47, 33, 'e'},
+    {47, 32, 'e'}, {47, 30, 'e'}, {48, 29, 'e'}, {48, 27, 'e'}, {49, 26, 'e'}, {49, 25, 'e'}, {50, 24, 'e'}, {50, 23, 'e'},
+    {50, 22, 'e'}, {51, 22, 'e'}, {51, 22, 'e'}, {52, 22, 'e'}, {52, 23, 'e'}, {53, 23, 'e'}, {53, 24, 'e'}, {53, 25, 'e'},
+    {54, 26, 'e'}, {54, 28, 'e'}, {55, 29, 'e'}, {55, 31, 'e'}, {56, 32, 'e'}, {56, 34, 'e'}, {57, 35, 'e'}, {57, 36, 'e'},
+    {57, 37, 'e'}, {58, 37, 'e'}, {58, 38, 'e'}, {59, 38, 'e'}, {59, 38, 'e'}, {60, 38, 'e'}, {60, 37, 'e'}, {60, 36, 'e'},
+    {61, 35, 'e'}, {61, 34, 'e'}, {62, 33, 'e'}, {62, 31, 'e'}, {63, 30, 'e'}, {63, 28, 'e'}, {63, 27, 'e'}, {64, 26, 'e'},
+    {64, 24, 'e'}, {65, 23, 'e'}, {65, 23, 'e'}, {66, 22, 'e'}, {66, 22, 'e'}, {67, 22, 'e'}, {67, 22, 'e'}, {67, 23, 'e'},
+    {68, 24, 'e'}, {68, 25, 'e'}, {69, 26, 'e'}, {69, 27, 'e'}, {70, 29, 'e'}, {70, 30, 'e'}, {0, 0, 'u'}, {64, 52, 's'},
+    {64, 51, 's'}, {64, 50, 's'}, {64, 49, 's'}, {64, 48, 's'}, {64, 47, 's'}, {64, 46, 's'}, {64, 45, 's'}, {64, 44, 's'},
+    {64, 43, 's'}, {64, 42, 's'}, {64, 41, 's'}, {64, 40, 's'}, {64, 39, 's'}, {64, 38, 's'}, {64, 37, 's'}, {64, 36, 's'},
+    {64, 35, 's'}, {64, 34, 's'}, {64, 33, 's'}, {64, 32, 's'}, {64, 31, 's'}, {64, 30, 's'}, {64, 29, 's'}, {64, 28, 's'},
+    {64, 27, 's'}, {64, 26, 's'}, {64, 25, 's'}, {64, 24, 's'}, {64, 23, 's'}, {64, 22, 's'}, {64, 21, 's'}, {64, 20, 's'},
+    {64, 19, 's'}, {64, 18, 's'}, {64, 17, 's'}, {64, 16, 's'}, {64, 15, 's'}, {64, 14, 's'}, {64, 13, 's'}, {64, 12, 's'},
+    {0, 0, 'u'}, {20, 20, 'p'}, {24, 20, 'p'}, {28, 20, 'p'}, {32, 20, 'p'}, {36, 20, 'p'}, {40, 20, 'p'}, {44, 20, 'p'},
+    {48, 20, 'p'}, {52, 20, 'p'}, {56, 20, 'p'}, {60, 20, 'p'}, {64, 20, 'p'}, {68, 20, 'p'}, {72, 20, 'p'}, {76, 20, 'p'},
+    {80, 20, 'p'}, {84, 20, 'p'}, {88, 20, 'p'}, {92, 20, 'p'}, {96, 20, 'p'}, {100, 20, 'p'}, {100, 24, 'p'}, {100, 29, 'p'},
+    {100, 33, 'p'}, {100, 37, 'p'}, {100, 41, 'p'}, {100, 46, 'p'}, {100, 50, 'p'}, {96, 50, 'p'}, {92, 50, 'p'}, {88, 50, 'p'},
+    {84, 50, 'p'}, {80, 50, 'p'}, {76, 50, 'p'}, {72, 50, 'p'}, {68, 50, 'p'}, {64, 50, 'p'}, {60, 50, 'p'}, {56, 50, 'p'},
+    {52, 50, 'p'}, {48, 50, 'p'}, {44, 50, 'p'}, {40, 50, 'p'}, {36, 50, 'p'}, {32, 50, 'p'}, {28, 50, 'p'}, {24, 50, 'p'},
+    {20, 50, 'p'}, {20, 46, 'p'}, {20, 41, 'p'}, {20, 37, 'p'}, {20, 33, 'p'}, {20, 29, 'p'}, {20, 24, 'p'}, {20, 20, 'p'},
+    {0, 0, 'u'},
+};
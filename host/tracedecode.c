@@ -0,0 +1,146 @@
+/* tracedecode.c
+ * print an instrumentation dump (KS0108_TRACE, see ks0108_trace.h and the
+ * format in ks0108_trace.c) as text
+ *
+ *   tracedecode [-s] dump
+ *
+ * The dump is what ks0108_TraceDump sent: trace.bin from bench-trace, or what
+ * paint.c sends over its UART, captured with e.g.
+ *   stty -F /dev/ttyUSB0 115200 raw && cat /dev/ttyUSB0 > dump
+ * -s prints the counters only, not every record in the ring.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ks0108_trace.h"
+
+#define MAX_DUMP 65536
+#define MAX_DEPTH 16        // sections of one kind open at once (nested, or in an interrupt)
+
+static const char *names[TRACE_SECTIONS] = { "busy", "gotoxy", "command", "flushstep", "lock", "irqoff" };
+
+static unsigned char dump[MAX_DUMP];
+static unsigned long hz;
+
+static unsigned long get(const unsigned char *p, int bytes)
+{
+    unsigned long value = 0;
+
+    while(bytes--)
+        value = value << 8 | p[bytes];
+    return value;
+}
+
+// clock ticks as microseconds
+static double us(unsigned long ticks)
+{
+    return ticks * 1e6 / hz;
+}
+
+int main(int argc, char **argv)
+{
+    FILE *f;
+    const unsigned char *p, *r;
+    const char *file;
+    unsigned long size, made, epoch = 0, time, open[TRACE_SECTIONS][MAX_DEPTH];
+    unsigned long gotoCalls = 0, gotoCommands = 0, irqLongest[256];
+    unsigned int sections, records, i, sum, depth[TRACE_SECTIONS], id, end, calls;
+    int summary = 0;
+
+    if(argc > 1 && strcmp(argv[1], "-s") == 0) {
+        summary = 1;
+        argc--;
+        argv++;
+    }
+    if(argc != 2) {
+        fprintf(stderr, "usage: tracedecode [-s] dump\n");
+        return 2;
+    }
+    file = argv[1];
+    if(!(f = fopen(file, "rb"))) {
+        fprintf(stderr, "tracedecode: can't read %s\n", file);
+        return 1;
+    }
+    size = fread(dump, 1, sizeof(dump), f);
+    fclose(f);
+
+    // header, then check that the rest is all there and adds up
+    if(size < 16 || memcmp(dump, "KTR1", 4) != 0) {
+        fprintf(stderr, "tracedecode: %s is not a trace dump\n", file);
+        return 1;
+    }
+    sections = dump[4];
+    records = get(dump + 6, 2);
+    made = get(dump + 8, 4);
+    hz = get(dump + 12, 4);
+    if(sections > TRACE_SECTIONS || hz == 0 || size != 16 + sections*10 + records*4 + 2) {
+        fprintf(stderr, "tracedecode: %s: %lu bytes don't fit %u sections and %u records\n", file, size,
+                sections, records);
+        return 1;
+    }
+    for(sum = 0, i = 0; i < size - 2; i++)
+        sum += dump[i];
+    if((sum & 0xFFFF) != get(dump + size - 2, 2)) {
+        fprintf(stderr, "tracedecode: %s: bad checksum\n", file);
+        return 1;
+    }
+
+    printf("%lu records made, the last %u kept, clock %lu Hz\n\n", made, records - 1, hz);
+    printf("%-10s %8s %12s %12s %12s\n", "section", "calls", "total us", "average us", "longest us");
+    for(i = 0, p = dump + 16; i < sections; i++, p += 10) {
+        calls = get(p, 2);
+        printf("%-10s %8u %12.1f %12.2f %12.2f\n", names[i], calls, us(get(p + 2, 4)),
+               calls ? us(get(p + 2, 4)) / calls : 0.0, us(get(p + 6, 4)));
+    }
+
+    // the ring: match up begins and ends, and keep some totals on the way
+    memset(depth, 0, sizeof(depth));
+    memset(irqLongest, 0, sizeof(irqLongest));
+    if(!summary)
+        printf("\n%14s  %s\n", "time us", "record");
+    for(i = 0, r = p; i < records; i++, r += 4) {
+        if(r[2] == TRACE_EPOCH) {
+            epoch = get(r, 2);
+            continue;
+        }
+        time = epoch << 16 | get(r, 2);
+        id = r[2] & ~TRACE_END;
+        end = r[2] & TRACE_END;
+        if(id >= TRACE_SECTIONS) {
+            fprintf(stderr, "tracedecode: %s: record %u has unknown section %u\n", file, i, id);
+            return 1;
+        }
+        if(!summary)
+            printf(id == TRACE_COMMAND ? "%14.3f  %*s%s %s 0x%02X" : "%14.3f  %*s%s %s %u", us(time),
+                   (end && depth[id] ? depth[id] - 1 : depth[id])*2, "", end ? "end  " : "begin", names[id], r[3]);
+        if(!end) {
+            if(depth[id] < MAX_DEPTH)
+                open[id][depth[id]] = time;
+            depth[id]++;
+        } else if(depth[id] > 0) {                  // (the begin may have gone round the ring)
+            depth[id]--;
+            if(depth[id] < MAX_DEPTH) {
+                if(!summary)
+                    printf("  %.3f us", us(time - open[id][depth[id]]));
+                if(id == TRACE_IRQOFF && time - open[id][depth[id]] > irqLongest[r[3]])
+                    irqLongest[r[3]] = time - open[id][depth[id]];
+            }
+        }
+        if(end && id == TRACE_GOTOXY) {
+            gotoCalls++;
+            gotoCommands += r[3];
+        }
+        if(!summary)
+            printf("\n");
+    }
+
+    if(!summary)
+        printf("\nin the ring:\n");
+    if(gotoCalls)
+        printf("  gotoxy sent %.2f commands per call (%lu calls)\n", (double)gotoCommands / gotoCalls, gotoCalls);
+    for(i = 0; i < 256; i++)
+        if(irqLongest[i])
+            printf("  interrupts off at %u for up to %.2f us\n", i, us(irqLongest[i]));
+    return 0;
+}
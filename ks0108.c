@@ -30,102 +30,1303 @@
     removed most functionality except SetDot (which updates the buffer)
     (future work: put the other functionality (rectangles, circles, fonts) back in
      and integrate it with the buffer)
+    lines, rectangles, circles and fonts are back, drawing into the buffer
      
 */
 
 #include <inttypes.h>
+#include <string.h>
 
 #define ksSOURCE
 #include "ks0108.h"
 
 #include "msp.h"
 
+// loop count of EN_DELAY() in en_delay.asm, part of the panel's timing profile
+unsigned int ks0108_EnDelay = EN_DELAY_VALUE;
+
 //#define GLCD_DEBUG  // uncomment this if you want to slow down drawing to see how pixels are set
 
-void ks0108_ClearPage(volatile ks0108 *this, uint8_t page, uint8_t color){
+#ifdef KS0108_GLASS_MIRROR
+static void ks0108_Mirror(ks0108 *this, uint8_t chip, uint8_t data);
+#else
+#define ks0108_Mirror(this, chip, data)
+#endif
+
+// the enable pin: a constant, or the instance's own with more than one panel
+// on the bus (KS0108_MULTIPANEL)
+#ifdef KS0108_MULTIPANEL
+#define EN_HIGH(this)   fastWritePins((this)->pins.en, (this)->pins.en)
+#define EN_LOW(this)    fastWritePins((this)->pins.en, 0)
+#else
+#define EN_HIGH(this)   fastWriteHigh(EN)
+#define EN_LOW(this)    fastWriteLow(EN)
+#endif
+
+// the select pins to set for a value of CHIPSELECT()
+#define SELECT_PINS(cs) (((cs) & 1 ? PIN_BIT(CSEL1) : 0) | ((cs) & 2 ? PIN_BIT(CSEL2) : 0))
+
+static void ks0108_RunIssue(ks0108 *this, uint8_t chip, uint8_t data);
+
+#ifdef KS0108_TILED
+// how a canvas page outside the window is kept (any other tileSize is the
+// length of its run-length code in the pool)
+#define TILE_WHITE  0x00
+#define TILE_BLACK  0xFF
+#define TILE_HOT    0xFE    // in the window
+
+// Run-length code of a page: a control byte c followed by either one byte to
+// repeat (c & 0x80: (c & 0x7F)+1 times) or c+1 literal bytes. Runs shorter than
+// three are left in the literals, so the code is never longer than 129 bytes.
+// dst of NULL just measures.
+static uint8_t ks0108_RleEncode(const uint8_t *src, uint8_t *dst){
+    uint8_t i = 0, start, run, n = 0;
+
+    while(i < DISPLAY_WIDTH){
+        for(run = 1; i + run < DISPLAY_WIDTH && run < 128 && src[i + run] == src[i]; run++)
+            ;
+        if(run >= 3){
+            if(dst){
+                dst[n] = 0x80 | (run - 1);
+                dst[n + 1] = src[i];
+            }
+            n += 2;
+            i += run;
+        } else {
+            start = i;
+            while(i < DISPLAY_WIDTH && i - start < 128
+                  && !(i + 2 < DISPLAY_WIDTH && src[i] == src[i+1] && src[i] == src[i+2]))
+                i++;
+            if(dst){
+                dst[n] = i - start - 1;
+                memcpy(dst + n + 1, src + start, i - start);
+            }
+            n += 1 + i - start;
+        }
+    }
+    return n;
+}
+
+static void ks0108_RleDecode(const uint8_t *src, uint8_t *dst){
+    uint8_t i = 0, c;
+
+    while(i < DISPLAY_WIDTH){
+        c = *src++;
+        if(c & 0x80){
+            memset(dst + i, *src++, (c & 0x7F) + 1);
+            i += (c & 0x7F) + 1;
+        } else {
+            memcpy(dst + i, src, c + 1);
+            src += c + 1;
+            i += c + 1;
+        }
+    }
+}
+
+// what a buffer page would take up in the pool
+static uint8_t ks0108_TileSize(const uint8_t *src){
     uint8_t x;
+
+    for(x = 1; x < DISPLAY_WIDTH && src[x] == src[0]; x++)
+        ;
+    if(x == DISPLAY_WIDTH && (src[0] == 0x00 || src[0] == 0xFF))
+        return src[0] ? TILE_BLACK : TILE_WHITE;
+    return ks0108_RleEncode(src, NULL);
+}
+
+// where a canvas page's code starts in the pool (the codes are in page order)
+static uint16_t ks0108_TileOffset(ks0108 *this, uint8_t page){
+    uint16_t offset = 0;
+    uint8_t p, size;
+
+    for(p = 0; p < page; p++){
+        size = this->tileSize[p];
+        if(size != TILE_WHITE && size != TILE_BLACK && size != TILE_HOT)
+            offset += size;
+    }
+    return offset;
+}
+
+// put a page's code into the pool (the caller has checked that it fits)
+static void ks0108_StoreTile(ks0108 *this, uint8_t page, const uint8_t *code, uint8_t size){
+    uint16_t offset;
+
+    if(size != TILE_WHITE && size != TILE_BLACK){
+        offset = ks0108_TileOffset(this, page);
+        memmove(this->pool + offset + size, this->pool + offset, this->poolUsed - offset);
+        memcpy(this->pool + offset, code, size);
+        this->poolUsed += size;
+    }
+    this->tileSize[page] = size;
+}
+
+// move a page from the pool to the buffer
+static void ks0108_LoadTile(ks0108 *this, uint8_t bufpage, uint8_t page){
+    uint8_t size = this->tileSize[page];
+    uint16_t offset;
+
+    if(size == TILE_WHITE || size == TILE_BLACK){
+        memset(this->buffer[bufpage], size, DISPLAY_WIDTH);
+    } else {
+        offset = ks0108_TileOffset(this, page);
+        ks0108_RleDecode(this->pool + offset, this->buffer[bufpage]);
+        memmove(this->pool + offset, this->pool + offset + size, this->poolUsed - offset - size);
+        this->poolUsed -= size;
+    }
+    this->tileSize[page] = TILE_HOT;
+    this->dirtyFrom[bufpage] = CANVAS_WIDTH;    // not on screen (SetStartLine marks it when it comes into view)
+    this->dirtyTo[bufpage] = 0;
+}
+
+// reverse the order of buffer pages [from, to), with their damage
+static void ks0108_ReversePages(ks0108 *this, uint8_t from, uint8_t to){
+    uint8_t x, t;
+
+    while(from + 1 < to){
+        to--;
+        for(x = 0; x < DISPLAY_WIDTH; x++){
+            t = this->buffer[from][x];
+            this->buffer[from][x] = this->buffer[to][x];
+            this->buffer[to][x] = t;
+        }
+        t = this->dirtyFrom[from];
+        this->dirtyFrom[from] = this->dirtyFrom[to];
+        this->dirtyFrom[to] = t;
+        t = this->dirtyTo[from];
+        this->dirtyTo[from] = this->dirtyTo[to];
+        this->dirtyTo[to] = t;
+        from++;
+    }
+}
+
+// slide the window so that a canvas row is near the middle of it
+// The buffer moves by whole screens, so the chips' start line doesn't change
+// and what they show stays valid. Each page that leaves is swapped with one
+// that comes in: the leaving page is coded, the new one decoded into its place
+// (freeing its code) and then the old code stored, so the pool only has to
+// hold the difference. The staying pages are then rotated into place.
+// Returns 0 if even that doesn't fit (the window stays where it is).
+static uint8_t ks0108_SlideWindow(ks0108 *this, int line){
+    uint8_t code[DISPLAY_WIDTH + 1], size[XPAGES*SCREENS];
+    uint8_t leaveFrom, enterFrom, n, i, left, in, progress;
+    int top, screens;
+    uint16_t need = 0, freed = 0;
+
+    top = line - (SCREENS-2)*DISPLAY_HEIGHT/2;
+    top = top < 0 ? 0 : top - top % DISPLAY_HEIGHT;
+    if(top > (CANVAS_SCREENS-SCREENS)*DISPLAY_HEIGHT)
+        top = (CANVAS_SCREENS-SCREENS)*DISPLAY_HEIGHT;
+    screens = (top - this->windowTop)/DISPLAY_HEIGHT;
+    if(screens == 0)
+        return 1;
+
+    // buffer pages that leave the window, and where the new pages belong
+    if(screens >= SCREENS || screens <= -SCREENS){
+        leaveFrom = enterFrom = 0;
+        n = XPAGES*SCREENS;
+    } else if(screens > 0){
+        leaveFrom = 0;
+        enterFrom = (SCREENS-screens)*XPAGES;
+        n = screens*XPAGES;
+    } else {
+        leaveFrom = (SCREENS+screens)*XPAGES;
+        enterFrom = 0;
+        n = -screens*XPAGES;
+    }
+
+    for(i = 0; i < n; i++){
+        size[i] = ks0108_TileSize(this->buffer[leaveFrom + i]);
+        if(size[i] != TILE_WHITE && size[i] != TILE_BLACK)
+            need += size[i];
+        in = this->tileSize[top/8 + enterFrom + i];
+        if(in != TILE_WHITE && in != TILE_BLACK)
+            freed += in;
+    }
+    if(need > KS0108_TILE_POOL - this->poolUsed + freed)
+        return 0;
+
+    // swap the pages, any pair whose difference fits first (if they all fit
+    // together there is always one that fits on its own)
+    left = n;
+    progress = 1;
+    while(left && progress){
+        progress = 0;
+        for(i = 0; i < n; i++){
+            if(size[i] == TILE_HOT)
+                continue;
+            in = this->tileSize[top/8 + enterFrom + i];
+            if(size[i] != TILE_WHITE && size[i] != TILE_BLACK
+               && size[i] > KS0108_TILE_POOL - this->poolUsed + (in != TILE_WHITE && in != TILE_BLACK ? in : 0))
+                continue;
+            if(size[i] != TILE_WHITE && size[i] != TILE_BLACK)
+                ks0108_RleEncode(this->buffer[leaveFrom + i], code);
+            ks0108_LoadTile(this, leaveFrom + i, top/8 + enterFrom + i);
+            ks0108_StoreTile(this, this->windowTop/8 + leaveFrom + i, code, size[i]);
+            size[i] = TILE_HOT;
+            left--;
+            progress = 1;
+        }
+    }
+
+    // the new pages are where the old ones were, rotate them to their end of the window
+    if(screens > 0 && screens < SCREENS){
+        ks0108_ReversePages(this, 0, n);
+        ks0108_ReversePages(this, n, XPAGES*SCREENS);
+        ks0108_ReversePages(this, 0, XPAGES*SCREENS);
+    } else if(screens < 0 && screens > -SCREENS){
+        ks0108_ReversePages(this, 0, leaveFrom);
+        ks0108_ReversePages(this, leaveFrom, XPAGES*SCREENS);
+        ks0108_ReversePages(this, 0, XPAGES*SCREENS);
+    }
+    this->windowTop = top;
+    this->startline -= screens*DISPLAY_HEIGHT;              // the same canvas row, which may now be outside the buffer
+    return 1;
+}
+
+// forget everything outside the window (it is white again)
+static void ks0108_ClearTiles(ks0108 *this){
+    uint8_t page;
+
+    for(page = 0; page < XPAGES*CANVAS_SCREENS; page++)
+        this->tileSize[page] = TILE_WHITE;
+    for(page = 0; page < XPAGES*SCREENS; page++)
+        this->tileSize[this->windowTop/8 + page] = TILE_HOT;
+    this->poolUsed = 0;
+}
+#endif
+
+// fill a page on every chip at once (CHIP_ALL selects all of them)
+void ks0108_ClearPage(ks0108 *this, uint8_t page, uint8_t color){
+    uint8_t x, chip;
+    uint16_t s;
     
-    for(x=0; x < DISPLAY_WIDTH; x++){   
-       ks0108_GotoXY(this, x, page * 8);
-       ks0108_WriteData(this, color);
-   }    
+#ifdef CHIPSELECT_ALL
+    chip = CHIP_ALL;                                    // one run fills every chip
+#else
+    for(chip=0; chip < DISPLAY_WIDTH/CHIP_WIDTH; chip++)
+#endif
+    {
+        KS0108_LOCK(s);                                 // a background flush waits for the run
+        ks0108_StartRun(this, chip, page, 0);
+        for(x=0; x < CHIP_WIDTH; x++){   
+           ks0108_RunByte(this, chip, color);
+        }
+        KS0108_UNLOCK(s);
+    }
+    this->Coord.x = 0;                                  // the column address wrapped around to 0
+    this->Coord.y = page * 8;
 }
 
 // clear screen, page by page
-void ks0108_ClearScreen(volatile ks0108 *this, uint8_t color){
+// (the buffer goes first, so a background flush in between only sends white)
+void ks0108_ClearScreen(ks0108 *this, uint8_t color){
+ uint16_t s;
+
+ KS0108_LOCK(s);
+ memset(this->buffer, 0, XPAGES*SCREENS*CANVAS_WIDTH*sizeof(uint8_t));  // clear in-RAM buffer
+#ifdef KS0108_TILED
+ ks0108_ClearTiles(this);                                               // and the rest of the canvas
+#endif
+ memset(this->dirtyFrom, CANVAS_WIDTH, XPAGES*SCREENS);                 // the glass will match the buffer...
+ memset(this->dirtyTo, 0, XPAGES*SCREENS);
+ KS0108_UNLOCK(s);
  ks0108_ClearScreenUnsafe(this, color);
- memset(this->buffer, 0, XPAGES*SCREENS*DISPLAY_WIDTH*sizeof(uint8_t)); // clear in-RAM buffer
+ if(color != WHITE)                                                     // ...unless it was filled with black
+    ks0108_Invalidate(this);
+ else if(this->pinnedWidth)                                             // the overlay was wiped too
+    ks0108_MarkRows(this, this->startline, this->startline + 8, this->startcol, this->startcol + this->pinnedWidth);
 }
 
 // clear the screen without clearing the buffer
-void ks0108_ClearScreenUnsafe(volatile ks0108 *this, uint8_t color){
+void ks0108_ClearScreenUnsafe(ks0108 *this, uint8_t color){
  uint8_t page;
    for( page = 0; page < 8; page++){
-      ks0108_GotoXY(this, 0, page * 8);
       ks0108_ClearPage(this, page, color);
  } 
+#ifdef KS0108_GLASS_MIRROR
+ this->glassKnown = 1;                  // every byte has just been written
+#endif
+}
+
+// note that columns [from, to) of a buffer page need to be sent to the screen
+// (buffer columns: the ones that are on screen are startcol .. startcol+DISPLAY_WIDTH-1)
+void ks0108_MarkDirty(ks0108 *this, uint8_t page, uint8_t from, uint8_t to){
+    uint16_t s;
+
+    if(page >= XPAGES*SCREENS || from >= to)
+        return;
+    if(to > CANVAS_WIDTH)
+        to = CANVAS_WIDTH;
+    KS0108_LOCK(s);                                 // FlushBegin may take the span in an interrupt
+    if(from < this->dirtyFrom[page])
+        this->dirtyFrom[page] = from;
+    if(to > this->dirtyTo[page])
+        this->dirtyTo[page] = to;
+    KS0108_UNLOCK(s);
+}
+
+// mark buffer rows [from, to) as changed in columns [x0, x1)
+void ks0108_MarkRows(ks0108 *this, int from, int to, uint8_t x0, uint8_t x1){
+    int page;
+
+    if(from < 0)
+        from = 0;
+    for(page = from/8; page*8 < to && page < XPAGES*SCREENS; page++)
+        ks0108_MarkDirty(this, page, x0, x1);
+}
+
+// mark every page on screen as changed
+void ks0108_Invalidate(ks0108 *this){
+    ks0108_MarkRows(this, this->startline, this->startline + DISPLAY_HEIGHT, this->startcol, this->startcol + DISPLAY_WIDTH);
+}
+
+// update one column of the pinned overlay, only marking it dirty if it changed
+void ks0108_SetPinned(ks0108 *this, uint8_t x, uint8_t data){
+    if(x >= CHIP_WIDTH || this->pinned[x] == data)
+        return;
+    this->pinned[x] = data;
+    if(x < this->pinnedWidth)
+        ks0108_MarkRows(this, this->startline, this->startline + 8, this->startcol + x, this->startcol + x+1);
+}
+
+// 8 rows of the buffer starting at any row (not just at a page boundary)
+static uint8_t ks0108_BufferByte(ks0108 *this, int row, uint8_t x){
+    uint8_t page = row/8, shift = row%8, data;
+
+    data = page < XPAGES*SCREENS ? this->buffer[page][x] : 0;
+    if(shift){
+        data >>= shift;
+        if(page+1 < XPAGES*SCREENS)
+            data |= this->buffer[page+1][x] << (8-shift);
+    }
+    return data;
+}
+
+// the byte that belongs on the glass at a given chip page and column
+// the chips show their RAM starting from the display start line (startline % 64),
+// so a chip page holds buffer rows startline+top .. startline+top+7, except for the
+// page that the start line falls in, which is split between the bottom and the top
+// of the screen. The pinned overlay covers the top 8 rows of the screen.
+// x is a screen column, the buffer column is startcol further on.
+static uint8_t ks0108_GlassByte(ks0108 *this, uint8_t page, uint8_t x){
+    uint8_t top, mask, data, col = this->startcol + x;
+
+    top = (page*8 + DISPLAY_HEIGHT - this->startline % DISPLAY_HEIGHT) % DISPLAY_HEIGHT; // screen row shown by bit 0
+    if(top <= DISPLAY_HEIGHT-8){
+        data = ks0108_BufferByte(this, this->startline + top, col);
+        if(top < 8 && x < this->pinnedWidth){
+            mask = 0xFF >> top;
+            data = (data & ~mask) | ((this->pinned[x] >> top) & mask);
+        }
+    } else {
+        top = DISPLAY_HEIGHT - top;                                 // bits below this are the bottom of the screen
+        mask = BITX(top) - 1;
+        data = ks0108_BufferByte(this, this->startline + DISPLAY_HEIGHT - top, col) & mask;
+        if(x < this->pinnedWidth)
+            data |= this->pinned[x] << top;
+        else
+            data |= ks0108_BufferByte(this, this->startline, col) << top;
+    }
+    return data;
+}
+
+// move the damage of the buffer pages on screen into the queue of chip page
+// runs that the flush works through (merging with anything already queued)
+// Drawing marks its damage after it has changed the buffer, so damage marked
+// while a background flush is collecting is never lost, at worst sent twice.
+// Damage left and right of the screen is dropped, SetViewport redraws the
+// whole screen when the columns change.
+void ks0108_FlushBegin(ks0108 *this){
+    uint8_t page, bufpage, from, to;
+    uint16_t s;
+    int row;
+
+    KS0108_LOCK(s);
+    for(row = this->startline - this->startline%8; row < this->startline + DISPLAY_HEIGHT; row += 8){
+        bufpage = row/8;
+        page = bufpage % XPAGES;
+        from = this->dirtyFrom[bufpage] > this->startcol ? this->dirtyFrom[bufpage] - this->startcol : 0;
+        to = this->dirtyTo[bufpage] > this->startcol ? this->dirtyTo[bufpage] - this->startcol : 0;
+        if(to > DISPLAY_WIDTH)
+            to = DISPLAY_WIDTH;
+        if(from < to){
+            if(from < this->queueFrom[page])
+                this->queueFrom[page] = from;
+            if(to > this->queueTo[page])
+                this->queueTo[page] = to;
+        }
+        this->dirtyFrom[bufpage] = CANVAS_WIDTH;
+        this->dirtyTo[bufpage] = 0;
+    }
+    KS0108_UNLOCK(s);
+}
+
+#ifdef KS0108_GLASS_MIRROR
+// skip what the glass already shows of queued columns [*x, end) of a chip page,
+// and stop the run at two bytes in a row that it shows (one is cheaper to send
+// again than a new SET_ADD), returns where the run stops (*x if there is none)
+static uint8_t ks0108_GlassRun(ks0108 *this, uint8_t page, uint8_t *x, uint8_t end){
+    uint8_t stop;
+
+    while(*x < end && ks0108_GlassByte(this, page, *x) == this->glass[page][*x])
+        (*x)++;
+    if(*x == end)
+        return end;
+    for(stop = *x + 1; stop < end; stop++)
+        if(ks0108_GlassByte(this, page, stop) == this->glass[page][stop]
+           && (stop + 1 == end || ks0108_GlassByte(this, page, stop+1) == this->glass[page][stop+1]))
+            break;
+    return stop;
+}
+#endif
+
+// find the next run of the queue: columns [*x, *end) of chip page *page, all
+// on one chip. Returns 0 if the queue is empty.
+static uint8_t ks0108_NextRun(ks0108 *this, uint8_t *page, uint8_t *x, uint8_t *end){
+    for(*page = 0; *page < XPAGES; (*page)++){
+        *x = this->queueFrom[*page];
+        while(*x < this->queueTo[*page]){
+            *end = (*x/CHIP_WIDTH + 1)*CHIP_WIDTH;                  // the run stops at the chip boundary
+            if(*end > this->queueTo[*page])
+                *end = this->queueTo[*page];
+#ifdef KS0108_GLASS_MIRROR
+            if(this->glassKnown){
+                *end = ks0108_GlassRun(this, *page, x, *end);
+                if(*x == *end){
+                    this->queueFrom[*page] = *x;
+                    continue;
+                }
+            }
+#endif
+            return 1;
+        }
+        this->queueFrom[*page] = DISPLAY_WIDTH;                     // this page is done
+        this->queueTo[*page] = 0;
+    }
+    return 0;
+}
+
+// the queue of a page has been sent up to column x
+static void ks0108_RunSent(ks0108 *this, uint8_t page, uint8_t x){
+    this->queueFrom[page] = x;
+    if(x >= this->queueTo[page]){                                   // this page is done
+        this->queueFrom[page] = DISPLAY_WIDTH;
+        this->queueTo[page] = 0;
+    }
+}
+
+// send at most budget bus transactions worth of the queue (a run's address
+// counts as two), starting a new flush when the queue is empty
+// returns nonzero while there is more to send. The bytes are taken from the
+// buffer as they are sent, so anything drawn in the meantime goes out too.
+// The FlushDone callback is called once when a flush that sent something runs
+// out of work, not on every idle call (and outside the lock).
+// Each run is sent under KS0108_LOCK, so Flush from the main loop and FlushStep
+// from a timer can both be in use: the timer gets in between runs.
+uint8_t ks0108_FlushStep(ks0108 *this, uint16_t budget){
+    uint8_t page, chip, x, end, more, done;
+    uint16_t s;
+    KS0108_TRACE_DECL(t)
+
+    KS0108_TRACE_BEGIN(t, TRACE_FLUSHSTEP, budget > 255 ? 255 : budget);
+    KS0108_LOCK(s);
+    for(page = 0; page < XPAGES; page++)                            // anything left of the last flush?
+        if(this->queueFrom[page] < this->queueTo[page])
+            break;
+    if(page == XPAGES)
+        ks0108_FlushBegin(this);
+
+    while(budget > 2 && ks0108_NextRun(this, &page, &x, &end)){
+        if(end - x > budget - 2)
+            end = x + budget - 2;
+        budget -= 2 + end - x;
+        this->flushing = 1;
+        chip = x/CHIP_WIDTH;
+        ks0108_StartRun(this, chip, page, x % CHIP_WIDTH);
+        for(; x < end; x++)
+            ks0108_RunByte(this, chip, ks0108_GlassByte(this, page, x));
+        ks0108_RunSent(this, page, x);
+        KS0108_UNLOCK(s);                                           // let interrupts in between runs
+        KS0108_LOCK(s);                                             // (one of them may have flushed too)
+    }
+
+    more = ks0108_FlushPending(this);
+    done = !more && this->flushing;
+    if(done)
+        this->flushing = 0;
+    KS0108_UNLOCK(s);
+    if(done && this->FlushDone)
+        this->FlushDone(this);
+    KS0108_TRACE_END(t, TRACE_FLUSHSTEP, more);
+    return more;
+}
+
+// is there anything on screen that the glass doesn't show yet?
+uint8_t ks0108_FlushPending(ks0108 *this){
+    uint8_t page, pending = 0;
+    uint16_t s;
+    int row;
+
+    KS0108_LOCK(s);                                 // the queue and the damage are read as one
+    for(page = 0; page < XPAGES; page++)
+        if(this->queueFrom[page] < this->queueTo[page])
+            pending = 1;
+    for(row = this->startline - this->startline%8; row < this->startline + DISPLAY_HEIGHT; row += 8)
+        if(this->dirtyFrom[row/8] < this->dirtyTo[row/8]
+           && this->dirtyFrom[row/8] < this->startcol + DISPLAY_WIDTH && this->dirtyTo[row/8] > this->startcol)
+            pending = 1;
+    KS0108_UNLOCK(s);
+    return pending;
+}
+
+#ifdef KS0108_MULTIPANEL
+// delays EN_DELAY()s have gone by: take them off what each panel that has a
+// timing profile still owes its chip
+static void ks0108_Elapse(ks0108 **panels, uint8_t *owed, uint8_t n, uint8_t delays){
+    uint8_t i;
+
+    for(i = 0; i < n; i++)
+        if(panels[i]->BusyDelay)
+            owed[i] = owed[i] > delays ? owed[i] - delays : 0;
+}
+
+// flush several panels on one bus together: a run is started on each of them
+// and their bytes go out in turn, so while one panel's chip is busy with a
+// byte the bus is sending to the others instead of waiting.
+// With a timing profile (BusyDelay) the time since each panel's last byte is
+// counted in EN_DELAY()s: the enable pulses of the other panels' bytes count
+// three each (the rest of the time in between isn't counted, which only makes
+// it safer), and the wait before a byte is only what is left of BusyDelay.
+// Without one the panel's busy flag is read before each byte, and is usually
+// clear by then. All the runs are sent under one KS0108_LOCK, which is let go
+// whenever one of them is over, then every panel starts a new run (SetAddress
+// sends nothing for the runs that carry on where they were).
+void ks0108_FlushPanels(ks0108 **panels, uint8_t n){
+    ks0108 *this;
+    uint8_t page[KS0108_MAX_PANELS], x[KS0108_MAX_PANELS], end[KS0108_MAX_PANELS], chip[KS0108_MAX_PANELS];
+    uint8_t owed[KS0108_MAX_PANELS]; // EN_DELAY()s the chip may still be busy (0 = ready, polled panels: 1 = poll)
+    uint8_t i, d, running, selected = 0xFF, over;
+    uint16_t s;
+
+    if(n > KS0108_MAX_PANELS)
+        n = KS0108_MAX_PANELS;
+    for(i = 0; i < n; i++)
+        ks0108_FlushBegin(panels[i]);
+    do {
+        KS0108_LOCK(s);
+        running = 0;
+        for(i = 0; i < n; i++){
+            this = panels[i];
+            if(!ks0108_NextRun(this, &page[i], &x[i], &end[i]))
+                continue;
+            this->flushing = 1;
+            chip[i] = x[i]/CHIP_WIDTH;
+            ks0108_StartRun(this, chip[i], page[i], x[i] % CHIP_WIDTH);
+            owed[i] = 0;                                            // StartRun waited for the chip
+            running |= BITX(i);
+            selected = i;                                           // and left it selected
+        }
+
+        over = !running;
+        while(!over){
+            for(i = 0; i < n && !over; i++){
+                if(!(running & BITX(i)))
+                    continue;
+                this = panels[i];
+                if(selected != i){
+                    ks0108_SelectChip(this, chip[i]);
+                    selected = i;
+                }
+                if(owed[i] && this->BusyDelay){
+                    for(d = owed[i]; d; d--)
+                        EN_DELAY();
+                    ks0108_Elapse(panels, owed, n, owed[i]);
+                } else if(owed[i]){
+                    ks0108_WaitReady(this, chip[i]);                // this turns the data port around
+                    fastWriteHigh(D_I);
+                    fastWriteLow(R_W);
+                    lcdDataDir(0xFF);
+                }
+                ks0108_RunIssue(this, chip[i], ks0108_GlassByte(this, page[i], x[i]));
+                ks0108_Elapse(panels, owed, n, 3);                  // the enable pulse is three EN_DELAY()s
+                owed[i] = this->BusyDelay ? this->BusyDelay : 1;
+                x[i]++;
+                over = x[i] == end[i];
+                ks0108_RunSent(this, page[i], x[i]);
+            }
+        }
+        KS0108_UNLOCK(s);                                           // let interrupts in between runs
+    } while(running);
+
+    for(i = 0; i < n; i++)                                          // what was drawn meanwhile, and FlushDone
+        ks0108_Flush(panels[i]);
+}
+#endif
+
+// send the dirty columns of every page on screen, page by page
+// each run needs a single SET_PAGE/SET_ADD per chip, the column
+// address then advances by itself after every data write
+void ks0108_Flush(ks0108 *this){
+    while(ks0108_FlushStep(this, 0xFFFF))
+        ;
+}
+
+// scroll to a new position in the buffer using the display start line of the chips
+// since the chips wrap around, only the rows that scrolled into view (and the pinned
+// overlay) have to be redrawn on the next flush, not the whole screen
+// (under KS0108_LOCK all the way, a background flush can't use half of it)
+void ks0108_SetStartLine(ks0108 *this, int line){
+    int old;
+    uint16_t s;
+
+    if(line < 0)
+        line = 0;
+    if(line > (CANVAS_SCREENS-1)*DISPLAY_HEIGHT)                   // don't go below the bottom
+        line = (CANVAS_SCREENS-1)*DISPLAY_HEIGHT;
+    KS0108_LOCK(s);
+#ifdef KS0108_TILED
+    if(line < this->windowTop || line > this->windowTop + (SCREENS-1)*DISPLAY_HEIGHT)
+        ks0108_SlideWindow(this, line);
+    line -= this->windowTop;                                        // from here on it is a buffer row
+    if(line < 0)                                                    // the pool was full, stop at the window
+        line = 0;
+    if(line > (SCREENS-1)*DISPLAY_HEIGHT)
+        line = (SCREENS-1)*DISPLAY_HEIGHT;
+#endif
+    old = this->startline;
+    if(line == old){
+        KS0108_UNLOCK(s);
+        return;
+    }
+    this->startline = line;
+
+    ks0108_WriteCommand(this, LCD_DISP_START | (line % DISPLAY_HEIGHT), CHIP_ALL);
+
+    if(line > old + DISPLAY_HEIGHT || line < old - DISPLAY_HEIGHT)
+        ks0108_Invalidate(this);
+    else if(line > old)
+        ks0108_MarkRows(this, old + DISPLAY_HEIGHT, line + DISPLAY_HEIGHT, this->startcol, this->startcol + DISPLAY_WIDTH);
+    else
+        ks0108_MarkRows(this, line, old, this->startcol, this->startcol + DISPLAY_WIDTH);
+
+    if(this->pinnedWidth){                                          // the overlay moves along with the start line
+        ks0108_MarkRows(this, old, old + 8, this->startcol, this->startcol + this->pinnedWidth);
+        ks0108_MarkRows(this, line, line + 8, this->startcol, this->startcol + this->pinnedWidth);
+    }
+    KS0108_UNLOCK(s);
+}
+
+// scroll by a number of rows (positive moves further down the buffer) and redraw
+void ks0108_Scroll(ks0108 *this, int lines){
+    ks0108_SetStartLine(this, ks0108_TopLine(this) + lines);
+    ks0108_Flush(this);
+}
+
+// move the screen to any pixel of the canvas
+// rows go through the chips' start line like SetStartLine, so a vertical step
+// of n rows costs about n/8+1 pages of writes. The chips have nothing like it
+// for columns: a horizontal step of any size redraws the whole screen (with
+// KS0108_GLASS_MIRROR, only the bytes that come out different). Flushing with
+// FlushStep from a timer spreads that over as many frames as the budget needs,
+// and FlushPending tells when the next step can be taken.
+void ks0108_SetViewport(ks0108 *this, int x, int y){
+    uint16_t s;
+
+    if(x < 0)
+        x = 0;
+    if(x > CANVAS_WIDTH - DISPLAY_WIDTH)
+        x = CANVAS_WIDTH - DISPLAY_WIDTH;
+    KS0108_LOCK(s);
+    ks0108_SetStartLine(this, y);
+    if(x != this->startcol){
+        this->startcol = x;
+        ks0108_Invalidate(this);
+    }
+    KS0108_UNLOCK(s);
+}
+
+// redraw the part of the buffer that is on screen (determined by startline and startcol)
+void ks0108_DumpBuffer(ks0108 *this){
+    ks0108_Invalidate(this);
+    ks0108_Flush(this);
+#ifdef KS0108_GLASS_MIRROR
+    this->glassKnown = 1;               // every byte is either written or compared now
+#endif
+}
+
+void ks0108_ForgetGlass(ks0108 *this){
+#ifdef KS0108_GLASS_MIRROR
+    this->glassKnown = 0;
+#endif
 }
 
 // draw a dot on the screen
-void ks0108_SetDot(volatile ks0108 *this, int xx, int yy, uint8_t color) {
-    uint8_t data, x, y;
+// the buffer is the source of truth: the dot is set there and the byte it lives
+// in is written straight to the glass, without reading the glass back first
+void ks0108_SetDot(ks0108 *this, int xx, int yy, uint8_t color) {
+    uint8_t x, y, col;
+    uint16_t s;
+    int row;
     
-    if (xx > 0 && xx < 128 && yy > 0 && yy < 64)        // range check
+    if (xx >= 0 && xx < DISPLAY_WIDTH && yy >= 0 && yy < DISPLAY_HEIGHT)  // range check
     {
+        KS0108_LOCK(s);
         x = xx;
-        y = yy;
+        col = x + this->startcol;                       // buffer column
+        row = yy + this->startline;                     // buffer row
+        y = row % DISPLAY_HEIGHT;                       // chip row (the chips wrap at the start line)
         
-        ks0108_GotoXY(this, x, y-y%8);                  // go to the page where x/y lives
+        if(color == BLACK)
+            this->buffer[row/8][col] |= BITX(row%8);    // set dot
+        else
+            this->buffer[row/8][col] &= ~BITX(row%8);   // clear dot
         
-        data = ks0108_ReadData(this);                   // read current contents of page
-        if(color == BLACK) {
-            data |= 0x01 << (y%8);                      // set dot
-            this->buffer[y/8 + this->startline/XPAGES][x] |= BITX(y%8);
+        ks0108_GotoXY(this, x, y-y%8);                  // go to the page where x/y lives
+        ks0108_WriteData(this, ks0108_GlassByte(this, y/8, x)); // write the whole byte (overlay included)
+        KS0108_UNLOCK(s);
+    }
+}
+
+// read the screen back and repair every byte that doesn't match the buffer
+// this is slow (two reads per byte) and only needed if something else may have
+// written to the chips, e.g. after they lost power
+// returns the number of bytes that were wrong
+uint16_t ks0108_Verify(ks0108 *this) {
+    uint8_t page, x, data;
+    uint16_t wrong = 0, s;
+
+    for(page = 0; page < XPAGES; page++){
+        for(x = 0; x < DISPLAY_WIDTH; x++){
+            KS0108_LOCK(s);
+            ks0108_GotoXY(this, x, page*8);
+            data = ks0108_GlassByte(this, page, x);
+            if(ks0108_ReadData(this) != data){          // ReadData undoes the inversion already
+                ks0108_WriteData(this, data);
+                wrong++;
+            }
+#ifdef KS0108_GLASS_MIRROR
+            this->glass[page][x] = data;
+#endif
+            KS0108_UNLOCK(s);
+        }
+    }
+#ifdef KS0108_GLASS_MIRROR
+    this->glassKnown = 1;
+#endif
+    return wrong;
+}
+
+// Drawing functions
+// these draw into the buffer only and mark what they touched as dirty,
+// ks0108_Flush() then puts it on the screen. Coordinates are screen coordinates
+// like SetDot (the row is relative to startline, the column to startcol), but
+// anything that is in the buffer can be drawn to, so shapes are only clipped at
+// the edges of the buffer.
+// Like the original library, widths and heights are one less than the number
+// of pixels (FillRect(0, 0, 127, 63) covers the screen).
+
+// fill columns [*x0, *x1) of buffer rows [*row0, *row1) with a color
+// the masks for the first and last page are worked out once, every page
+// in between is filled a whole byte at a time. Nothing is marked dirty, the
+// clipped area is left in the arguments for the caller to mark
+uint8_t ks0108_FillBuffer(ks0108 *this, int *x0, int *x1, int *row0, int *row1, uint8_t color){
+    uint8_t page, last, mask, x;
+
+    if(*x0 < 0)
+        *x0 = 0;
+    if(*x1 > CANVAS_WIDTH)
+        *x1 = CANVAS_WIDTH;
+    if(*row0 < 0)
+        *row0 = 0;
+    if(*row1 > XPAGES*SCREENS*8)
+        *row1 = XPAGES*SCREENS*8;
+    if(*x0 >= *x1 || *row0 >= *row1)
+        return 0;
+
+    last = (*row1-1)/8;
+    for(page = *row0/8; page <= last; page++){
+        mask = 0xFF;
+        if(page == *row0/8)
+            mask &= 0xFF << (*row0%8);                  // top page: rows from row0 down
+        if(page == last)
+            mask &= 0xFF >> (7 - (*row1-1)%8);          // bottom page: rows up to row1-1
+        if(mask == 0xFF){
+            for(x = *x0; x < *x1; x++)
+                this->buffer[page][x] = color;
+        } else {
+            for(x = *x0; x < *x1; x++)
+                this->buffer[page][x] = (this->buffer[page][x] & ~mask) | (color & mask);
+        }
+    }
+    return 1;
+}
+
+// fill columns [x0, x1) of buffer rows [row0, row1) with a color and mark it dirty
+static void ks0108_FillArea(ks0108 *this, int x0, int x1, int row0, int row1, uint8_t color){
+    if(ks0108_FillBuffer(this, &x0, &x1, &row0, &row1, color))
+        ks0108_MarkRows(this, row0, row1, x0, x1);
+}
+
+// set a dot in the buffer (SetDot does the same and writes it to the screen straight away)
+void ks0108_DrawDot(ks0108 *this, int x, int y, uint8_t color){
+    x += this->startcol;
+    y += this->startline;
+    if(x < 0 || x >= CANVAS_WIDTH || y < 0 || y >= XPAGES*SCREENS*8)
+        return;
+    if(color == BLACK)
+        this->buffer[y/8][x] |= BITX(y%8);
+    else
+        this->buffer[y/8][x] &= ~BITX(y%8);
+    ks0108_MarkDirty(this, y/8, x, x+1);
+}
+
+void ks0108_FillRect(ks0108 *this, int x, int y, int width, int height, uint8_t color){
+    if(width < 0 || height < 0)
+        return;
+    x += this->startcol;
+    y += this->startline;
+    ks0108_FillArea(this, x, x + width + 1, y, y + height + 1, color);
+}
+
+// clear a rectangle and put it on the screen straight away
+// only the pages it spans are written, one run per page and chip
+void ks0108_EraseRect(ks0108 *this, int x, int y, int width, int height){
+    ks0108_FillRect(this, x, y, width, height, WHITE);
+    ks0108_Flush(this);
+}
+
+void ks0108_DrawHoriLine(ks0108 *this, int x, int y, int width, uint8_t color){
+    ks0108_FillRect(this, x, y, width, 0, color);
+}
+
+// a vertical line is a column of whole bytes, plus the partial bytes at its ends
+void ks0108_DrawVertLine(ks0108 *this, int x, int y, int height, uint8_t color){
+    ks0108_FillRect(this, x, y, 0, height, color);
+}
+
+void ks0108_DrawRect(ks0108 *this, int x, int y, int width, int height, uint8_t color){
+    ks0108_DrawHoriLine(this, x, y, width, color);              // top
+    ks0108_DrawHoriLine(this, x, y + height, width, color);     // bottom
+    ks0108_DrawVertLine(this, x, y, height, color);             // left
+    ks0108_DrawVertLine(this, x + width, y, height, color);     // right
+}
+
+// Bresenham's line, straight lines go through FillRect instead
+void ks0108_DrawLine(ks0108 *this, int x1, int y1, int x2, int y2, uint8_t color){
+    int dx, dy, sx, sy, err, e2;
+
+    if(y1 == y2){
+        ks0108_DrawHoriLine(this, x1 < x2 ? x1 : x2, y1, x1 < x2 ? x2 - x1 : x1 - x2, color);
+        return;
+    }
+    if(x1 == x2){
+        ks0108_DrawVertLine(this, x1, y1 < y2 ? y1 : y2, y1 < y2 ? y2 - y1 : y1 - y2, color);
+        return;
+    }
+
+    dx = x2 > x1 ? x2 - x1 : x1 - x2;
+    dy = y2 > y1 ? y1 - y2 : y2 - y1;                           // negative
+    sx = x1 < x2 ? 1 : -1;
+    sy = y1 < y2 ? 1 : -1;
+    err = dx + dy;
+    while(1){
+        ks0108_DrawDot(this, x1, y1, color);
+        if(x1 == x2 && y1 == y2)
+            break;
+        e2 = 2*err;
+        if(e2 >= dy){
+            err += dy;
+            x1 += sx;
+        }
+        if(e2 <= dx){
+            err += dx;
+            y1 += sy;
+        }
+    }
+}
+
+// midpoint circle, one octant is worked out and mirrored into the other seven
+void ks0108_DrawCircle(ks0108 *this, int xCenter, int yCenter, int radius, uint8_t color){
+    int x = radius, y = 0, err = 1 - radius;
+
+    if(radius < 0)
+        return;
+    while(x >= y){
+        ks0108_DrawDot(this, xCenter + x, yCenter + y, color);
+        ks0108_DrawDot(this, xCenter - x, yCenter + y, color);
+        ks0108_DrawDot(this, xCenter + x, yCenter - y, color);
+        ks0108_DrawDot(this, xCenter - x, yCenter - y, color);
+        ks0108_DrawDot(this, xCenter + y, yCenter + x, color);
+        ks0108_DrawDot(this, xCenter - y, yCenter + x, color);
+        ks0108_DrawDot(this, xCenter + y, yCenter - x, color);
+        ks0108_DrawDot(this, xCenter - y, yCenter - x, color);
+        y++;
+        if(err < 0){
+            err += 2*y + 1;
+        } else {
+            x--;
+            err += 2*(y - x) + 1;
+        }
+    }
+}
+
+// Bitmap functions
+// Bitmaps are the original library's format: width, height, then one byte per
+// column for each 8-row page of the image, page by page (the font layout).
+// A strip of source bytes lands on one buffer page when its top row is on a
+// page boundary and is split over two pages otherwise. The split is a single
+// 16-bit shift per column: the low byte goes into the upper page and the high
+// byte into the lower one, with the same shift applied to the mask.
+
+// combine a buffer byte with a source byte under a mask (1 = change this pixel)
+static uint8_t ks0108_Rop(uint8_t dest, uint8_t src, uint8_t mask, uint8_t rop){
+    switch(rop){
+    case ROP_OR:
+        return dest | (src & mask);
+    case ROP_AND:
+        return dest & (src | ~mask);
+    case ROP_XOR:
+        return dest ^ (src & mask);
+    default:
+        return (dest & ~mask) | (src & mask);
+    }
+}
+
+// put one 8-row strip of columns into the buffer at any row and column
+// rows masks the source rows that are part of the image, data of NULL is
+// all background (e.g. the space after a character), mask of NULL is opaque
+static void ks0108_BlitStrip(ks0108 *this, int row, int x, const uint8_t *data, const uint8_t *mask,
+                             uint8_t rows, uint8_t width, uint8_t rop, uint8_t invert){
+    int top;
+    uint8_t i, s, x0, x1, upper, lower, d, m;
+    uint16_t dd, mm;
+    uint8_t *p;
+
+    if(row <= -8 || row >= XPAGES*SCREENS*8 || x >= CANVAS_WIDTH || x + width <= 0)
+        return;
+    x0 = x < 0 ? -x : 0;                                    // clip to the width of the buffer
+    x1 = x + width > CANVAS_WIDTH ? CANVAS_WIDTH - x : width;
+
+    top = (row + 8)/8 - 1;                                  // page of the strip's first row
+    s = (row + 8)%8;
+    upper = top >= 0;
+    lower = s && top + 1 < XPAGES*SCREENS;                  // does it spill into the next page?
+
+    if(s == 0 && rop == ROP_COPY && mask == NULL && rows == 0xFF){
+        p = this->buffer[top];                              // on a page boundary: straight copy
+        for(i = x0; i < x1; i++)
+            p[x + i] = (data ? data[i] : 0) ^ invert;
+    } else {
+        for(i = x0; i < x1; i++){
+            d = (data ? data[i] : 0) ^ invert;
+            m = mask ? mask[i] & rows : rows;
+            dd = (uint16_t)d << s;
+            mm = (uint16_t)m << s;
+            if(upper)
+                this->buffer[top][x + i] = ks0108_Rop(this->buffer[top][x + i], dd, mm, rop);
+            if(lower)
+                this->buffer[top + 1][x + i] = ks0108_Rop(this->buffer[top + 1][x + i], dd >> 8, mm >> 8, rop);
+        }
+    }
+    if(upper)
+        ks0108_MarkDirty(this, top, x + x0, x + x1);
+    if(lower)
+        ks0108_MarkDirty(this, top + 1, x + x0, x + x1);
+}
+
+void ks0108_BlitMasked(ks0108 *this, const uint8_t *bitmap, const uint8_t *mask, int x, int y, uint8_t rop){
+    uint8_t width = bitmap[0], height = bitmap[1], page, pages, rows;
+    int row = y + this->startline;
+
+    pages = (height + 7)/8;
+    for(page = 0; page < pages; page++){
+        rows = (page == pages-1 && height%8) ? 0xFF >> (8 - height%8) : 0xFF;
+        ks0108_BlitStrip(this, row + page*8, x + this->startcol, bitmap + 2 + page*width,
+                         mask ? mask + 2 + page*width : NULL, rows, width, rop, 0x00);
+    }
+}
+
+void ks0108_Blit(ks0108 *this, const uint8_t *bitmap, int x, int y, uint8_t rop){
+    ks0108_BlitMasked(this, bitmap, NULL, x, y, rop);
+}
+
+// Text functions
+// Fonts are the ks0108 library's tables: a short header, a width table for
+// proportional fonts, then for each character one byte per column and page,
+// page by page (see SystemFont5x7.h). That is the buffer's own layout, so a
+// character whose top is on a page boundary is copied byte for byte, and one
+// that isn't is shifted across two pages.
+
+// remembered string widths (see ks0108_StringWidthCached)
+#define WIDTH_CACHE 8
+static struct {
+    const uint8_t *font;
+    const char *str;
+    uint16_t width;
+} widthCache[WIDTH_CACHE];
+static uint8_t widthCacheNext;
+
+void ks0108_SelectFont(ks0108 *this, const uint8_t *font, uint8_t color){
+    this->Font = font;
+    this->FontColor = color;
+}
+
+void ks0108_CursorTo(ks0108 *this, uint8_t column, uint8_t row){
+    if(this->Font == NULL)
+        return;
+    this->CursorX = column * (this->Font[FONT_FIXED_WIDTH] + 1);
+    this->CursorY = row * ((this->Font[FONT_HEIGHT] + 7) & ~7);
+}
+
+void ks0108_CursorToXY(ks0108 *this, int x, int y){
+    this->CursorX = x;
+    this->CursorY = y;
+}
+
+uint8_t ks0108_PutChar(ks0108 *this, char c){
+    const uint8_t *font = this->Font, *glyph;
+    uint8_t width, height, pages, page, first, shift, invert, i;
+    int row;
+
+    if(font == NULL)
+        return 0;
+    height = font[FONT_HEIGHT];
+    pages = (height + 7)/8;
+    if(c == '\n'){
+        this->CursorX = 0;
+        this->CursorY += pages*8;
+        return 0;
+    }
+    first = font[FONT_FIRST_CHAR];
+    if((uint8_t)c < first || (uint8_t)c >= first + font[FONT_CHAR_COUNT])
+        return 0;
+    c -= first;
+
+    // find the character
+    if(font[FONT_LENGTH] == 0 && font[FONT_LENGTH+1] == 0){ // fixed width
+        width = font[FONT_FIXED_WIDTH];
+        glyph = font + FONT_WIDTH_TABLE + c*width*pages;
+    } else {                                                // proportional: add up the widths before it
+        width = font[FONT_WIDTH_TABLE + c];
+        glyph = font + FONT_WIDTH_TABLE + font[FONT_CHAR_COUNT];
+        for(i = 0; i < (uint8_t)c; i++)
+            glyph += font[FONT_WIDTH_TABLE + i]*pages;
+    }
+
+    invert = this->FontColor == BLACK ? 0x00 : 0xFF;
+    row = this->CursorY + this->startline;
+    for(page = 0; page < pages; page++){
+        // like the original library, the last page of a font taller than 8 rows
+        // is stored bottom aligned, so it goes in higher up with its top rows left out
+        shift = (height > 8 && height < (page+1)*8) ? (page+1)*8 - height : 0;
+        ks0108_BlitStrip(this, row + page*8 - shift, this->CursorX + this->startcol, glyph + page*width, NULL,
+                         0xFF << shift, width, ROP_COPY, invert);
+        ks0108_BlitStrip(this, row + page*8 - shift, this->CursorX + this->startcol + width, NULL, NULL,
+                         0xFF << shift, 1, ROP_COPY, invert);
+    }
+    this->CursorX += width + 1;
+    return width + 1;
+}
+
+void ks0108_Puts(ks0108 *this, const char *str){
+    int x = this->CursorX;
+
+    while(*str){
+        if(*str == '\n'){
+            ks0108_PutChar(this, '\n');
+            this->CursorX = x;                              // back to where the string started
         } else {
-            data &= ~(0x01 << (y%8));                   // clear dot
-            this->buffer[y/8 + this->startline/XPAGES][x] &= ~BITX(y%8);
-        }   
-        ks0108_WriteData(this, data);                   // write data back to display
+            ks0108_PutChar(this, *str);
+        }
+        str++;
     }
 }
 
+void ks0108_PrintNumber(ks0108 *this, long n){
+    char digits[12];
+    uint8_t i = 0;
+    unsigned long u = n < 0 ? -(unsigned long)n : n;
+
+    if(n < 0)
+        ks0108_PutChar(this, '-');
+    do {
+        digits[i++] = '0' + u%10;
+        u /= 10;
+    } while(u);
+    while(i)
+        ks0108_PutChar(this, digits[--i]);
+}
+
+uint8_t ks0108_CharWidth(ks0108 *this, char c){
+    const uint8_t *font = this->Font;
+    uint8_t first;
+
+    if(font == NULL)
+        return 0;
+    first = font[FONT_FIRST_CHAR];
+    if((uint8_t)c < first || (uint8_t)c >= first + font[FONT_CHAR_COUNT])
+        return 0;
+    if(font[FONT_LENGTH] == 0 && font[FONT_LENGTH+1] == 0)
+        return font[FONT_FIXED_WIDTH] + 1;
+    return font[FONT_WIDTH_TABLE + (uint8_t)c - first] + 1;
+}
+
+uint16_t ks0108_StringWidth(ks0108 *this, const char *str){
+    uint16_t width = 0;
+
+    while(*str)
+        width += ks0108_CharWidth(this, *str++);
+    return width;
+}
+
+// measuring a proportional string means a trip through the width table per
+// character; labels that are laid out every frame (centred, right aligned)
+// only pay for it once
+uint16_t ks0108_StringWidthCached(ks0108 *this, const char *str){
+    uint8_t i;
+
+    for(i = 0; i < WIDTH_CACHE; i++){
+        if(widthCache[i].str == str && widthCache[i].font == this->Font)
+            return widthCache[i].width;
+    }
+    i = widthCacheNext;
+    widthCacheNext = (widthCacheNext + 1) % WIDTH_CACHE;
+    widthCache[i].font = this->Font;
+    widthCache[i].str = str;
+    widthCache[i].width = ks0108_StringWidth(this, str);
+    return widthCache[i].width;
+}
+
 // set display to a given X/Y position
 // these are external X/Y coords, not chip coords
-void ks0108_GotoXY(volatile ks0108 *this, uint8_t x, uint8_t y) {
-    uint8_t chip, cmd;
-    
+void ks0108_GotoXY(ks0108 *this, uint8_t x, uint8_t y) {
+    uint8_t sent;
+    KS0108_TRACE_DECL(t)
+
     if( (x > DISPLAY_WIDTH-1) || (y > DISPLAY_HEIGHT-1) )   // exit if coordinates are not legal
         return;
+    KS0108_TRACE_BEGIN(t, TRACE_GOTOXY, x);
     this->Coord.x = x;                                      // save new coordinates
     this->Coord.y = y;
 
-    // Only set the page if the chip is not already in that page
-    if(y/8 != this->Coord.page) {
-        this->Coord.page = y/8;
-        cmd = LCD_SET_PAGE | this->Coord.page;              // set y address on all chips   
-        for(chip=0; chip < DISPLAY_WIDTH/CHIP_WIDTH; chip++){
-            ks0108_WriteCommand(this, cmd, chip);   
+    // pick a chip based on X coord, and set X coord relative to chip
+    sent = ks0108_SetAddress(this, x/CHIP_WIDTH, y/8, x % CHIP_WIDTH);
+    KS0108_TRACE_END(t, TRACE_GOTOXY, sent);
+}
+
+// move a chip's page and column counters (chip may be CHIP_ALL)
+// the driver keeps track of where every chip's counters are, including
+// the column increment after each read and write, so only commands that
+// actually change something get sent (returns how many)
+uint8_t ks0108_SetAddress(ks0108 *this, uint8_t chip, uint8_t page, uint8_t column) {
+    uint8_t i, first = chip, last = chip, setPage = 0, setColumn = 0;
+
+    if(chip == CHIP_ALL){
+        first = 0;
+        last = DISPLAY_WIDTH/CHIP_WIDTH - 1;
+    }
+    for(i = first; i <= last; i++){
+        setPage |= this->chipPage[i] != page;
+        setColumn |= this->chipColumn[i] != column;
+    }
+    if(setPage)
+        ks0108_WriteCommand(this, LCD_SET_PAGE | page, chip);
+    if(setColumn)
+        ks0108_WriteCommand(this, LCD_SET_ADD | column, chip);
+    return setPage + setColumn;
+}
+
+#ifdef KS0108_GLASS_MIRROR
+// note a data byte (as the buffer has it, before inversion) written to a chip
+// at its current address, call before ks0108_Track moves the column on
+static void ks0108_Mirror(ks0108 *this, uint8_t chip, uint8_t data) {
+    uint8_t last = chip;
+
+    if(chip == CHIP_ALL){
+        chip = 0;
+        last = DISPLAY_WIDTH/CHIP_WIDTH - 1;
+    }
+    for(; chip <= last; chip++){
+        if(this->chipPage[chip] < XPAGES && this->chipColumn[chip] < CHIP_WIDTH)
+            this->glass[this->chipPage[chip]][chip*CHIP_WIDTH + this->chipColumn[chip]] = data;
+        else
+            this->glassKnown = 0;                           // it went somewhere, but we don't know where
+    }
+}
+#endif
+
+// follow the chips' address counters after a command or data access
+static void ks0108_Track(ks0108 *this, uint8_t chip, uint8_t cmd, boolean d_i) {
+    uint8_t last = chip;
+
+    if(chip == CHIP_ALL){
+        chip = 0;
+        last = DISPLAY_WIDTH/CHIP_WIDTH - 1;
+    }
+    for(; chip <= last; chip++){
+        if(d_i){                                            // reads and writes advance the column
+            if(this->chipColumn[chip] < CHIP_WIDTH)
+                this->chipColumn[chip] = (this->chipColumn[chip] + 1) % CHIP_WIDTH;
+        } else if((cmd & 0xF8) == LCD_SET_PAGE) {
+            this->chipPage[chip] = cmd & 0x07;
+        } else if((cmd & 0xC0) == LCD_SET_ADD) {
+            this->chipColumn[chip] = cmd & 0x3F;
         }
     }
-    chip = this->Coord.x/CHIP_WIDTH;                        // pick a chip based on X coord
-    x = x % CHIP_WIDTH;                                     // set X coord relative to chip
-    cmd = LCD_SET_ADD | x;
-    ks0108_WriteCommand(this, cmd, chip);                   // set x address on active chip 
 }
 
-void ks0108_Init(volatile ks0108 *this, boolean invert) {
+#ifdef KS0108_MULTIPANEL
+void ks0108_PanelPins(ks0108_pins *pins, uint8_t en) {
     uint8_t chip;
 
+    pins->en = en;
+    pins->csMask = PIN_BIT(CSEL1) | PIN_BIT(CSEL2);
+    for(chip = 0; chip < DISPLAY_WIDTH/CHIP_WIDTH; chip++)
+        pins->cs[chip] = SELECT_PINS(CHIPSELECT(chip));
+#ifdef CHIPSELECT_ALL
+    pins->cs[chip] = SELECT_PINS(CHIPSELECT_ALL);
+#else
+    pins->cs[chip] = SELECT_PINS(CHIPSELECT(CHIP_ALL)); // (never used, CHIP_ALL goes chip by chip)
+#endif
+}
+
+void ks0108_Init(ks0108 *this, boolean invert) {
+    ks0108_pins pins;
+
+    ks0108_PanelPins(&pins, PIN_BIT(EN));
+    ks0108_InitPanel(this, &pins, invert);
+}
+
+void ks0108_InitPanel(ks0108 *this, const ks0108_pins *pins, boolean invert) {
+    this->pins = *pins;
+#else
+void ks0108_Init(ks0108 *this, boolean invert) {
+#endif
     this->startline = 0; // reset scroll position to top
-    memset(this->buffer, 0, XPAGES*SCREENS*DISPLAY_WIDTH*sizeof(uint8_t));
+    this->startcol = 0; // and to the left
+#ifdef KS0108_TILED
+    this->windowTop = 0; // the window starts at the top of the canvas
+    ks0108_ClearTiles(this);
+#endif
+    memset(this->buffer, 0, XPAGES*SCREENS*CANVAS_WIDTH*sizeof(uint8_t));
                         // clear in-RAM buffer
+    this->pinnedWidth = 0; // no overlay until the application asks for one
+    this->Font = NULL; // no text until SelectFont
+    memset(this->queueFrom, DISPLAY_WIDTH, XPAGES); // nothing queued for the glass
+    memset(this->queueTo, 0, XPAGES);
+    this->FlushDone = NULL;
+    this->flushing = 0;
+#ifdef KS0108_GLASS_MIRROR
+    this->glassKnown = 0; // until ClearScreen has written every byte
+#endif
+    this->CursorX = this->CursorY = 0;
       
-    // set controls pins to output direction
-    pinMode(D_I,OUTPUT);
-    pinMode(R_W,OUTPUT);    
-    pinMode(EN,OUTPUT);     
-    pinMode(CSEL1,OUTPUT);
-    pinMode(CSEL2,OUTPUT);
+    // set controls pins to output direction (one write, the pins are constants)
+#ifdef KS0108_MULTIPANEL
+    LCD_CMD_DIR |= PIN_BIT(D_I) | PIN_BIT(R_W) | this->pins.en | this->pins.csMask;
+#else
+    LCD_CMD_DIR |= PIN_BIT(D_I) | PIN_BIT(R_W) | PIN_BIT(EN) | PIN_BIT(CSEL1) | PIN_BIT(CSEL2);
+#endif
 
     delay(10);
 
@@ -136,68 +1337,161 @@ void ks0108_Init(volatile ks0108 *this, boolean invert) {
 
     fastWriteLow(D_I);
     fastWriteLow(R_W);
-    fastWriteLow(EN);
+    EN_LOW(this);
 
     // reset current position to top
     this->Coord.x = 0;
     this->Coord.y = 0;
-    this->Coord.page = 0;
+    memset(this->chipPage, 0xFF, sizeof(this->chipPage));    // we don't know where the chips are yet
+    memset(this->chipColumn, 0xFF, sizeof(this->chipColumn));
     
     this->Inverted = invert;
+    this->WriteOnly = 0;    // poll the busy flag until told otherwise
+#ifdef LCD_BUSY_DELAY
+    this->BusyDelay = LCD_BUSY_DELAY; // timing profile from ks0108_Panel.h (ks0108_Calibrate can measure it)
+#else
+    this->BusyDelay = 0;
+#endif
     
     // turn on the chips
-    for(chip=0; chip < DISPLAY_WIDTH/CHIP_WIDTH; chip++){
-       delay(10);  
-       ks0108_WriteCommand(this, LCD_ON, chip);             // power on
-       ks0108_WriteCommand(this, LCD_DISP_START, chip);     // display start line = 0
-    }
+    delay(10);  
+    ks0108_WriteCommand(this, LCD_ON, CHIP_ALL);            // power on
+    ks0108_WriteCommand(this, LCD_DISP_START, CHIP_ALL);    // display start line = 0
     delay(50);                                              // wait for the chips to come on
     ks0108_ClearScreen(this, invert ? BLACK : WHITE);       // display clear
     ks0108_GotoXY(this, 0,0);
 }
 
-// select one chip or the other
-inline void ks0108_SelectChip(volatile ks0108 *this, uint8_t chip) {  
-//static uint8_t prevchip; 
-    if(chipSelect[chip] & 1)
-       fastWriteHigh(CSEL1);
-    else
-       fastWriteLow(CSEL1);
+// select one chip or the other (or all of them, see CHIPSELECT_ALL in ks0108_Panel.h)
+// both select lines change in a single write to the command port
+inline void ks0108_SelectChip(ks0108 *this, uint8_t chip) {  
+#ifdef KS0108_MULTIPANEL
+    fastWritePins(this->pins.csMask, this->pins.cs[chip == CHIP_ALL ? DISPLAY_WIDTH/CHIP_WIDTH : chip]);
+#else
+    uint8_t cs;
 
-    if(chipSelect[chip] & 2)
-       fastWriteHigh(CSEL2);
-    else
-       fastWriteLow(CSEL2);
+#ifdef CHIPSELECT_ALL
+    cs = (chip == CHIP_ALL) ? CHIPSELECT_ALL : CHIPSELECT(chip);
+#else
+    cs = CHIPSELECT(chip);
+#endif
+    fastWritePins(PIN_BIT(CSEL1) | PIN_BIT(CSEL2), SELECT_PINS(cs));
+#endif
 }
 
 // wait until LCD busy bit goes to zero
-void ks0108_WaitReady(volatile ks0108 *this,  uint8_t chip){
+// for CHIP_ALL every chip is checked in turn, then they are all selected
+// in WriteOnly mode the busy flag is never read, we just wait as long as
+// the timing profile says the chips can be busy
+void ks0108_WaitReady(ks0108 *this,  uint8_t chip){
+    uint8_t i;
+    KS0108_TRACE_DECL(t)
 
+    if(this->WriteOnly && this->BusyDelay){             // (without a profile there is nothing to wait by)
+        ks0108_SelectChip(this, chip);
+        KS0108_TRACE_BEGIN(t, TRACE_BUSY, chip);
+        for(i = this->BusyDelay; i; i--)
+            EN_DELAY();
+        KS0108_TRACE_END(t, TRACE_BUSY, chip);
+        return;
+    }
+#ifdef CHIPSELECT_ALL
+    if(chip == CHIP_ALL){
+        for(chip=0; chip < DISPLAY_WIDTH/CHIP_WIDTH; chip++)
+            ks0108_WaitReady(this, chip);
+        ks0108_SelectChip(this, CHIP_ALL);
+        return;
+    }
+#endif
     ks0108_SelectChip(this, chip);
     lcdDataDir(0x00);
     fastWriteLow(D_I);  
     fastWriteHigh(R_W); 
-    fastWriteHigh(EN);  
+    EN_HIGH(this);  
     EN_DELAY();
+    KS0108_TRACE_BEGIN(t, TRACE_BUSY, chip);
     while(LCD_DATA_IN_HIGH & LCD_BUSY_FLAG)
         ;
-    fastWriteLow(EN);   
+    KS0108_TRACE_END(t, TRACE_BUSY, chip);
+    EN_LOW(this);   
 
     
 }
 
+// read the status register of a chip (busy flag, on/off and reset bits)
+uint8_t ks0108_ReadStatus(ks0108 *this, uint8_t chip){
+    uint8_t status;
+
+    ks0108_SelectChip(this, chip);
+    lcdDataDir(0x00);
+    fastWriteLow(D_I);  
+    fastWriteHigh(R_W); 
+    EN_HIGH(this);  
+    EN_DELAY();
+    status = LCD_DATA_IN_HIGH;
+    EN_LOW(this);   
+    return status;
+}
+
+// measure how many EN_DELAY()s the chips stay busy after a data write and store
+// that in the timing profile (BusyDelay), which runs and WriteOnly mode use
+// instead of polling. Each chip is sent the byte that belongs at its page 0,
+// column 0 (what the buffer says the glass shows there, so nothing changes),
+// the same way as a byte of a run, followed by a growing wait until the busy
+// flag is always clear by the time it is checked.
+// This needs the R/W line, so run it once with R/W connected (the chips must be on).
+// Returns 0 if a chip never came ready (no R/W line, or a dead chip): the timing
+// profile is left as it was then.
+uint8_t ks0108_Calibrate(ks0108 *this){
+    uint8_t chip, wait, i, pass, busy, longest = 0;
+    boolean writeOnly = this->WriteOnly;
+    uint16_t s;
+
+    this->WriteOnly = 0;
+    for(chip=0; chip < DISPLAY_WIDTH/CHIP_WIDTH && longest < 0xFF; chip++){
+        for(pass = 0; pass < 4 && longest < 0xFF; pass++){
+            for(wait = 0; wait < 0xFF; wait++){
+                KS0108_LOCK(s);                     // a background flush would throw the timing off
+                ks0108_StartRun(this, chip, 0, 0);
+                ks0108_RunIssue(this, chip, ks0108_GlassByte(this, 0, chip*CHIP_WIDTH));
+                for(i = wait; i; i--)
+                    EN_DELAY();
+                busy = ks0108_ReadStatus(this, chip) & LCD_BUSY_FLAG;
+                KS0108_UNLOCK(s);
+                if(!busy)
+                    break;
+            }
+            if(wait > longest)
+                longest = wait;
+        }
+    }
+    this->WriteOnly = writeOnly;
+    if(longest == 0xFF)                             // still busy after the longest wait
+        return 0;
+    this->BusyDelay = longest + 1;                  // one more for margin
+    return 1;
+}
+
+// stop (or start) reading the busy flag, which needs a timing profile to wait by instead
+uint8_t ks0108_SetWriteOnly(ks0108 *this, boolean writeOnly){
+    if(writeOnly && !this->BusyDelay)
+        return 0;
+    this->WriteOnly = writeOnly;
+    return 1;
+}
+
 // pulse the enable pin, which causes whichever LCD chip is
 // current enabled to accept a command
-inline void ks0108_Enable(volatile ks0108 *this) {  
+inline void ks0108_Enable(ks0108 *this) {  
    EN_DELAY();
-   fastWriteHigh(EN);       // EN high level width min 450 ns
+   EN_HIGH(this);       // EN high level width min 450 ns
    EN_DELAY();
-   fastWriteLow(EN);
+   EN_LOW(this);
    EN_DELAY();              // some displays may need this delay at the end of the enable pulse
 }
 
 // actually read a byte of pixel data from the current position on the display
-uint8_t ks0108_DoReadData(volatile ks0108 *this, uint8_t first) {
+uint8_t ks0108_DoReadData(ks0108 *this, uint8_t first) {
     uint8_t data, chip;
 
     chip = this->Coord.x/CHIP_WIDTH;
@@ -211,7 +1505,7 @@ uint8_t ks0108_DoReadData(volatile ks0108 *this, uint8_t first) {
     fastWriteHigh(D_I);                 // D/I = 1
     fastWriteHigh(R_W);                 // R/W = 1
     
-    fastWriteHigh(EN);                  // EN high level width: min. 450ns
+    EN_HIGH(this);                  // EN high level width: min. 450ns
     EN_DELAY();
 
 #ifdef LCD_DATA_NIBBLES
@@ -219,7 +1513,8 @@ uint8_t ks0108_DoReadData(volatile ks0108 *this, uint8_t first) {
 #else
      data = LCD_DATA_IN_LOW;            // low and high nibbles on same port so read all 8 bits at once
 #endif 
-    fastWriteLow(EN); 
+    EN_LOW(this); 
+    ks0108_Track(this, chip, 0, 1);     // the read moved the column on
     if(first == 0) 
       ks0108_GotoXY(this, this->Coord.x, this->Coord.y);    
     if(this->Inverted)
@@ -228,7 +1523,7 @@ uint8_t ks0108_DoReadData(volatile ks0108 *this, uint8_t first) {
 }
 
 // read a byte of pixel data
-inline uint8_t ks0108_ReadData(volatile ks0108 *this) {  
+inline uint8_t ks0108_ReadData(ks0108 *this) {  
     ks0108_DoReadData(this, 1);                 // dummy read
     return ks0108_DoReadData(this, 0);          // "real" read
     this->Coord.x++;
@@ -236,14 +1531,27 @@ inline uint8_t ks0108_ReadData(volatile ks0108 *this) {
 
 // write a command to the screen
 // (normal version with D_I and R_W low, for most commands)
-void ks0108_WriteCommand(volatile ks0108 *this, uint8_t cmd, uint8_t chip) {
+void ks0108_WriteCommand(ks0108 *this, uint8_t cmd, uint8_t chip) {
     ks0108_DoWriteCommand(this, cmd, chip, 0, 0);
 }
 
 // extra configurability for sending commands that don't have
 // D_I and R_W both low (for example when we want to directly
 // write pixel data without going through WriteData)
-void ks0108_DoWriteCommand(volatile ks0108 *this, uint8_t cmd, uint8_t chip, boolean d_i, boolean r_w) {
+// (one transaction, under KS0108_LOCK so that it can be used alongside a background flush)
+void ks0108_DoWriteCommand(ks0108 *this, uint8_t cmd, uint8_t chip, boolean d_i, boolean r_w) {
+    uint16_t s;
+    KS0108_TRACE_DECL(t)
+
+#ifndef CHIPSELECT_ALL
+    if(chip == CHIP_ALL){                           // this panel can't select all chips at once
+        for(chip=0; chip < DISPLAY_WIDTH/CHIP_WIDTH; chip++)
+            ks0108_DoWriteCommand(this, cmd, chip, d_i, r_w);
+        return;
+    }
+#endif
+    KS0108_LOCK(s);
+    KS0108_TRACE_BEGIN(t, TRACE_COMMAND, cmd);
      if(this->Coord.x % CHIP_WIDTH == 0 && chip > 0){
         EN_DELAY();
     }
@@ -255,15 +1563,82 @@ void ks0108_DoWriteCommand(volatile ks0108 *this, uint8_t cmd, uint8_t chip, boo
     EN_DELAY();
     lcdDataOut(cmd);
     ks0108_Enable(this);                            // enable pulse min width 450 ns
+    if(d_i && !r_w)                                 // a data byte, sent as it is
+        ks0108_Mirror(this, chip, this->Inverted ? ~cmd : cmd);
+    ks0108_Track(this, chip, cmd, d_i);
     EN_DELAY();
     EN_DELAY();
     lcdDataOut(0x00);
+    KS0108_TRACE_END(t, TRACE_COMMAND, cmd);
+    KS0108_UNLOCK(s);
+}
+
+// get a chip ready for a run of data writes starting at page/column
+// (chip may be CHIP_ALL); the data port stays an output until the run is over
+void ks0108_StartRun(ks0108 *this, uint8_t chip, uint8_t page, uint8_t column) {
+    ks0108_SetAddress(this, chip, page, column);
+    ks0108_WaitReady(this, chip);
+    fastWriteHigh(D_I);                 // D/I = 1
+    fastWriteLow(R_W);                  // R/W = 0
+    lcdDataDir(0xFF);                   // data port is output
+}
+
+// put the next byte of a run on the bus, without waiting for the chip
+static void ks0108_RunIssue(ks0108 *this, uint8_t chip, uint8_t data) {
+    ks0108_Mirror(this, chip, data);
+    if(this->Inverted)
+        data = ~data;
+    lcdDataOut(data);                   // write data
+    ks0108_Enable(this);                // enable
+    ks0108_Track(this, chip, 0, 1);
+}
+
+// write the next byte of a run, the chip moves on to the next column by itself
+// if the timing profile knows the busy time (BusyDelay, see ks0108_Calibrate) we just
+// wait that long afterwards, otherwise the busy flag is polled like everywhere else
+void ks0108_RunByte(ks0108 *this, uint8_t chip, uint8_t data) {
+    uint8_t i;
+
+    ks0108_RunIssue(this, chip, data);
+    if(this->BusyDelay){
+        for(i = this->BusyDelay; i; i--)
+            EN_DELAY();
+    } else {
+        ks0108_WaitReady(this, chip);   // this turns the data port around, so set it up again
+        fastWriteHigh(D_I);
+        fastWriteLow(R_W);
+        lcdDataDir(0xFF);
+    }
+}
+
+// write len bytes to a page of the screen starting at column x, without going
+// through the buffer. The address is set once per chip and the run carries on
+// into the next chip at the CHIP_WIDTH boundary.
+void ks0108_WritePageRun(ks0108 *this, uint8_t page, uint8_t x, const uint8_t *src, uint8_t len) {
+    uint8_t chip, end;
+    uint16_t s;
+
+    while(len && x < DISPLAY_WIDTH){
+        chip = x/CHIP_WIDTH;
+        end = (chip+1)*CHIP_WIDTH;
+        if(end > x + len)
+            end = x + len;
+        KS0108_LOCK(s);
+        ks0108_StartRun(this, chip, page, x % CHIP_WIDTH);
+        for(; x < end; x++, len--)
+            ks0108_RunByte(this, chip, *src++);
+        KS0108_UNLOCK(s);
+    }
+    this->Coord.x = x;
+    this->Coord.y = page*8;
 }
 
 // write pixel data to the screen
-void ks0108_WriteData(volatile ks0108 *this, uint8_t data) {
+void ks0108_WriteData(ks0108 *this, uint8_t data) {
     uint8_t displayData, yOffset, chip;
+#ifdef GLCD_DEBUG
     volatile uint16_t i;
+#endif
 
 #ifdef LCD_CMD_PORT 
     uint8_t cmdPort;    
@@ -305,10 +1680,12 @@ void ks0108_WriteData(volatile ks0108 *this, uint8_t data) {
         lcdDataDir(0xFF);                           // data port is output
         
         displayData |= data << yOffset;
+        ks0108_Mirror(this, chip, displayData);
         if(this->Inverted)
             displayData = ~displayData;
         lcdDataOut( displayData);                   // write data
         ks0108_Enable(this);                        // enable
+        ks0108_Track(this, chip, 0, 1);
         
         // second page
         ks0108_GotoXY(this, this->Coord.x, this->Coord.y+8);
@@ -325,20 +1702,24 @@ void ks0108_WriteData(volatile ks0108 *this, uint8_t data) {
         lcdDataDir(0xFF);                           // data port is output
         
         displayData |= data >> (8-yOffset);
+        ks0108_Mirror(this, chip, displayData);
         if(this->Inverted)
             displayData = ~displayData;
         lcdDataOut(displayData);                    // write data
         ks0108_Enable(this);                        // enable
+        ks0108_Track(this, chip, 0, 1);
         
         ks0108_GotoXY(this, this->Coord.x+1, this->Coord.y-8);
     }
     else // the whole write is on one page
     {
+        ks0108_Mirror(this, chip, data);
         if(this->Inverted)
             data = ~data;     
         EN_DELAY();
         lcdDataOut(data);                           // write data
         ks0108_Enable(this);                        // enable
+        ks0108_Track(this, chip, 0, 1);
         this->Coord.x++;
     }
 }
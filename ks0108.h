@@ -38,7 +38,11 @@ typedef uint8_t byte;
 #define GLCD_VERSION 2 // software version of this library
 
 // Chip specific includes
+#ifdef KS0108_HOST
+#include "host/ks0108_host.h"  // PC build: pins drive the bus model in host/ks0108_sim.c
+#else
 #include "ks0108_msp430.h"
+#endif
 
 #include "ks0108_Panel.h"      // this contains LCD panel specific configuration
 
@@ -84,6 +88,23 @@ typedef uint8_t byte;
 
 #define LCD_BUSY_FLAG       0x80 
 
+// pass this as the chip to send the same command or data to every chip at once
+#define CHIP_ALL            0xFF
+
+// Font indices (see SystemFont5x7.h for the font format)
+#define FONT_LENGTH         0
+#define FONT_FIXED_WIDTH    2
+#define FONT_HEIGHT         3
+#define FONT_FIRST_CHAR     4
+#define FONT_CHAR_COUNT     5
+#define FONT_WIDTH_TABLE    6
+
+// Raster operations for ks0108_Blit
+#define ROP_COPY            0   // the bitmap replaces what is there
+#define ROP_OR              1   // only the bitmap's dark pixels are drawn
+#define ROP_AND             2   // only the bitmap's light pixels are drawn
+#define ROP_XOR             3   // the bitmap's dark pixels invert (blit again to undo)
+
 // Colors
 #define BLACK               0xFF
 #define WHITE               0x00
@@ -99,7 +120,6 @@ typedef uint8_t byte;
 typedef struct {
     uint8_t x;
     uint8_t y;
-    uint8_t page; // the chips split up the X axis (which is the Y axis externally) into 8-pixel pages
 } lcdCoord;
 
 // macros to convert common operations into primitives
@@ -108,55 +128,239 @@ typedef struct {
 // number of pages on a screen
 #define XPAGES  8
 // number of screens we will buffer in memory
+#ifdef KS0108_TILED
+// Tiled canvas: the buffer is a window of SCREENS screens that slides over a
+// canvas of CANVAS_SCREENS screens, a whole screen at a time, to keep the
+// part on screen in the middle. Pages outside the window are kept as a tag if
+// they are all white or all black, and run-length coded in a pool otherwise.
+// Drawing reaches the window only. The default fits 16 screens of mostly
+// blank content in about the RAM of the flat 4 screen buffer.
+#define SCREENS 3
+#ifndef CANVAS_SCREENS
+#define CANVAS_SCREENS 16
+#endif
+#ifndef KS0108_TILE_POOL
+#define KS0108_TILE_POOL 1024 // bytes of run-length coded pages
+#endif
+#define ks0108_TopLine(this) ((this)->windowTop + (this)->startline) // canvas row at the top of the screen
+#else
+#ifndef SCREENS
 #define SCREENS 4
+#endif
+#define CANVAS_SCREENS SCREENS
+#define ks0108_TopLine(this) ((this)->startline) // canvas row at the top of the screen
+#endif
+// number of columns in the buffer, the screen shows DISPLAY_WIDTH of them
+// starting at startcol (at most 255: 255 columns of 2 SCREENS take about the
+// RAM of the default 128 columns of 4)
+#ifndef CANVAS_WIDTH
+#define CANVAS_WIDTH DISPLAY_WIDTH
+#endif
+#if CANVAS_WIDTH < DISPLAY_WIDTH || CANVAS_WIDTH > 255
+#error "CANVAS_WIDTH has to be from DISPLAY_WIDTH to 255"
+#endif
+#if defined(KS0108_TILED) && CANVAS_WIDTH != DISPLAY_WIDTH
+#error "the tiled canvas is one screen wide"
+#endif
+#define ks0108_LeftColumn(this) ((this)->startcol) // canvas column at the left of the screen
+
+#ifdef KS0108_MULTIPANEL
+// Several panels on one bus: they share the data port, D/I and R/W (and the
+// geometry above), and each has its own enable pin, so every ks0108 instance
+// talks to its own panel. The select lines can be shared too, only the panel
+// whose enable pulses listens to them.
+#ifndef KS0108_MAX_PANELS
+#define KS0108_MAX_PANELS 4 // most panels ks0108_FlushPanels interleaves
+#endif
+
+typedef struct {
+    uint8_t             en; // enable pin (a bit of LCD_CMD_PORT)
+    uint8_t             cs[DISPLAY_WIDTH/CHIP_WIDTH + 1]; // select pins to set for each chip, then for CHIP_ALL
+    uint8_t             csMask; // every select pin of the panel
+} ks0108_pins;
+#endif
 
 // BEGIN ks0108 class ported from C++ to C
 
-typedef struct   // shell struct for ks0108 glcd code
+typedef struct ks0108   // shell struct for ks0108 glcd code
 {
-    lcdCoord            Coord; // current screen coordinate
+    // state that ks0108_FlushStep uses, which may be called from an interrupt
+    // handler: it only reads the buffer (drawing marks its damage after the
+    // change), the rest is changed under KS0108_LOCK (see msp.h) by the driver
+#ifdef KS0108_MULTIPANEL
+    ks0108_pins         pins; // where this panel is on the bus
+#endif
+    uint8_t             chipPage[DISPLAY_WIDTH/CHIP_WIDTH]; // page counter of each chip (0xFF = unknown)
+                                // (the chips split up the X axis (which is the Y axis externally) into 8-pixel pages)
+    uint8_t             chipColumn[DISPLAY_WIDTH/CHIP_WIDTH]; // column counter of each chip (0xFF = unknown)
     boolean             Inverted; // is the screen inverted (this is handled in software)
-    uint8_t             buffer[XPAGES*SCREENS][DISPLAY_WIDTH]; // in-RAM screen buffer (same width, 4x height of physical screen)
-    int                 startline; // current Y position in the buffer
+    boolean             WriteOnly; // never read the busy flag, wait BusyDelay instead (R/W can be tied low, see SetWriteOnly)
+    uint8_t             BusyDelay; // EN_DELAY()s the chips can stay busy after an access (0 = unknown, poll)
+    uint8_t             buffer[XPAGES*SCREENS][CANVAS_WIDTH]; // in-RAM screen buffer (CANVAS_WIDTH wide, 4x height of physical screen)
+    int                 startline; // current Y position in the buffer (any row, the chips' start line follows it)
+    uint8_t             startcol; // current X position in the buffer (any column, every byte is redrawn when it changes)
+    uint8_t             dirtyFrom[XPAGES*SCREENS]; // first buffer column of each buffer page that the glass doesn't show yet
+    uint8_t             dirtyTo[XPAGES*SCREENS]; // one past the last such column (dirtyFrom >= dirtyTo means clean)
+    uint8_t             pinned[CHIP_WIDTH]; // overlay for the top page of the left chip (e.g. a status bar), doesn't scroll
+    uint8_t             pinnedWidth; // number of overlay columns in use (0 = no overlay)
+#ifdef KS0108_GLASS_MIRROR
+    uint8_t             glass[XPAGES][DISPLAY_WIDTH]; // what the chips' RAM holds, by chip page and column
+    boolean             glassKnown; // glass can be trusted (every write since the last full redraw went to a known address)
+#endif
+    uint8_t             queueFrom[XPAGES]; // columns of each chip page that the flush still has to send
+    uint8_t             queueTo[XPAGES];
+    void                (*FlushDone)(struct ks0108 *this); // called when a flush has sent everything (or NULL)
+    uint8_t             flushing; // FlushStep has sent part of a flush and not yet called FlushDone
+
+    // state that only the drawing code uses
+    lcdCoord            Coord; // current screen coordinate
+#ifdef KS0108_TILED
+    int                 windowTop; // canvas row of the first buffer row (a whole number of screens)
+    uint16_t            poolUsed; // bytes of the pool in use
+    uint8_t             tileSize[XPAGES*CANVAS_SCREENS]; // how each canvas page is kept (TILE_WHITE etc. in ks0108.c,
+                                // or the length of its run-length code, the codes are in the pool in page order)
+    uint8_t             pool[KS0108_TILE_POOL];
+#endif
+    const uint8_t *     Font; // font used by PutChar/Puts (NULL until SelectFont)
+    uint8_t             FontColor; // BLACK for dark text on white, WHITE for the opposite
+    int                 CursorX; // where PutChar draws the next character, in screen coordinates
+    int                 CursorY;
 } ks0108;
 
 // inter-chip communication functions
-inline uint8_t ks0108_ReadData(volatile ks0108 *this);
+// (these don't lock: with FlushStep in an interrupt handler, call them under KS0108_LOCK,
+// everything further down locks by itself where it has to)
+inline uint8_t ks0108_ReadData(ks0108 *this);
     // read pixel data
-uint8_t ks0108_DoReadData(volatile ks0108 *this, uint8_t first);
+uint8_t ks0108_DoReadData(ks0108 *this, uint8_t first);
     // helper function for ReadData
-void ks0108_WriteCommand(volatile ks0108 *this, uint8_t cmd, uint8_t chip);
-    // write a command (see ks0108 docs for instruction set)
-void ks0108_DoWriteCommand(volatile ks0108 *this, uint8_t cmd, uint8_t chip, boolean d_i, boolean r_w);
+void ks0108_WriteCommand(ks0108 *this, uint8_t cmd, uint8_t chip);
+    // write a command (see ks0108 docs for instruction set), chip may be CHIP_ALL
+void ks0108_DoWriteCommand(ks0108 *this, uint8_t cmd, uint8_t chip, boolean d_i, boolean r_w);
     // write a command (more flexible than WriteCommand because the D_I(RS) and R_W lines are configurable)
-void ks0108_WriteData(volatile ks0108 *this, uint8_t ks0108_data);
+void ks0108_WriteData(ks0108 *this, uint8_t ks0108_data);
     // write pixel data
-inline void ks0108_Enable(volatile ks0108 *this);
+void ks0108_StartRun(ks0108 *this, uint8_t chip, uint8_t page, uint8_t column);
+    // set up a chip (or CHIP_ALL) for a run of data writes
+void ks0108_RunByte(ks0108 *this, uint8_t chip, uint8_t data);
+    // write the next byte of a run (the chip's column advances by itself)
+void ks0108_WritePageRun(ks0108 *this, uint8_t page, uint8_t x, const uint8_t *src, uint8_t len);
+    // write a run of bytes to a page of the screen, crossing chips as needed
+inline void ks0108_Enable(ks0108 *this);
     // create the enable pulse that causes the ks0108 to accept a command
-inline void ks0108_SelectChip(volatile ks0108 *this, uint8_t chip);
+inline void ks0108_SelectChip(ks0108 *this, uint8_t chip);
     // select one of the LCD chips
-void ks0108_WaitReady(volatile ks0108 *this,  uint8_t chip);
+void ks0108_WaitReady(ks0108 *this,  uint8_t chip);
     // wait for the LCD chip to be ready for input
+uint8_t ks0108_ReadStatus(ks0108 *this, uint8_t chip);
+    // read the status register (busy flag) of a chip once
 
 // Control functions
-void ks0108_Init(volatile ks0108 *this, boolean invert);
+void ks0108_Init(ks0108 *this, boolean invert);
     // call this function first or nothing will work
-void ks0108_GotoXY(volatile ks0108 *this, uint8_t x, uint8_t y);
+#ifdef KS0108_MULTIPANEL
+void ks0108_PanelPins(ks0108_pins *pins, uint8_t en);
+    // pins of a panel wired like the one in ks0108_msp430.h, but enabled by en (e.g. PIN_BIT(EN2))
+void ks0108_InitPanel(ks0108 *this, const ks0108_pins *pins, boolean invert);
+    // Init for the panel at pins (Init is the one at EN), init every panel before using any of them
+#endif
+uint8_t ks0108_Calibrate(ks0108 *this);
+    // measure the busy time after a data write into BusyDelay (needs R/W), 0 if a chip never came ready
+uint8_t ks0108_SetWriteOnly(ks0108 *this, boolean writeOnly);
+    // stop (or start) reading the busy flag, 0 if there is no BusyDelay to wait by instead
+void ks0108_GotoXY(ks0108 *this, uint8_t x, uint8_t y);
     // move the "cursor" to a specific X/Y position
     // this is external X/Y, where X=[0,127] and Y=[0,63]
     //
+uint8_t ks0108_SetAddress(ks0108 *this, uint8_t chip, uint8_t page, uint8_t column);
+    // move a chip's page/column counters, skipping commands it doesn't need, returns the number it sent
 // Graphic Functions
-void ks0108_ClearPage(volatile ks0108 *this, uint8_t page, uint8_t color);
-void ks0108_ClearScreen(volatile ks0108 *this, uint8_t color);
-void ks0108_SetDot(volatile ks0108 *this, int xx, int yy, uint8_t color);
+void ks0108_ClearPage(ks0108 *this, uint8_t page, uint8_t color);
+    // fill a page of the screen (not the buffer) with a color
+void ks0108_ClearScreen(ks0108 *this, uint8_t color);
+void ks0108_SetDot(ks0108 *this, int xx, int yy, uint8_t color);
+    // set a dot in the buffer and write its byte through to the screen (no readback)
+uint16_t ks0108_Verify(ks0108 *this);
+    // read back the whole screen and fix bytes that differ from the buffer (slow)
+
+// Drawing functions (into the buffer only, ks0108_Flush puts them on screen)
+// widths and heights are one less than the number of pixels, as in the original library
+void ks0108_DrawDot(ks0108 *this, int x, int y, uint8_t color);
+void ks0108_DrawLine(ks0108 *this, int x1, int y1, int x2, int y2, uint8_t color);
+void ks0108_DrawHoriLine(ks0108 *this, int x, int y, int width, uint8_t color);
+void ks0108_DrawVertLine(ks0108 *this, int x, int y, int height, uint8_t color);
+void ks0108_DrawRect(ks0108 *this, int x, int y, int width, int height, uint8_t color);
+void ks0108_FillRect(ks0108 *this, int x, int y, int width, int height, uint8_t color);
+void ks0108_DrawCircle(ks0108 *this, int xCenter, int yCenter, int radius, uint8_t color);
+void ks0108_EraseRect(ks0108 *this, int x, int y, int width, int height);
+    // FillRect in WHITE, then Flush (for callers without a background flush)
+
+// Bitmap functions (into the buffer only, like the drawing functions)
+// bitmaps are {width, height, data...} with one byte per column for each 8-row page
+void ks0108_Blit(ks0108 *this, const uint8_t *bitmap, int x, int y, uint8_t rop);
+    // draw a bitmap with its top left corner at x/y, clipped to the buffer
+void ks0108_BlitMasked(ks0108 *this, const uint8_t *bitmap, const uint8_t *mask, int x, int y, uint8_t rop);
+    // mask is a bitmap of the same size, only pixels set in it are drawn (a transparent sprite)
+
+// Text functions (into the buffer only, like the drawing functions)
+void ks0108_SelectFont(ks0108 *this, const uint8_t *font, uint8_t color);
+    // font is one of the tables in SystemFont5x7.h etc.
+void ks0108_CursorTo(ks0108 *this, uint8_t column, uint8_t row);
+    // move the text cursor to a character cell (for fixed width fonts)
+void ks0108_CursorToXY(ks0108 *this, int x, int y);
+    // move the text cursor to a pixel position (top left of the next character)
+uint8_t ks0108_PutChar(ks0108 *this, char c);
+    // draw a character at the cursor and move the cursor past it, returns the width used
+void ks0108_Puts(ks0108 *this, const char *str);
+    // draw a string, '\n' moves to the start of the next line
+void ks0108_PrintNumber(ks0108 *this, long n);
+uint8_t ks0108_CharWidth(ks0108 *this, char c);
+    // width of a character in the current font, including the space after it
+uint16_t ks0108_StringWidth(ks0108 *this, const char *str);
+uint16_t ks0108_StringWidthCached(ks0108 *this, const char *str);
+    // StringWidth, remembered by font and string address (only for strings that don't change)
 
 // New Functions (by Burka/Stromme)
-void ks0108_ClearScreenUnsafe(volatile ks0108 *this, uint8_t color);
+void ks0108_ClearScreenUnsafe(ks0108 *this, uint8_t color);
     // does not clear the buffer
-void ks0108_DumpBuffer(volatile ks0108 *this);
-    // implemented in paint.c
+void ks0108_DumpBuffer(ks0108 *this);
+    // redraw the whole screen from the buffer (with KS0108_GLASS_MIRROR, only the bytes that differ)
+void ks0108_ForgetGlass(ks0108 *this);
+    // the chips may have lost what they showed (e.g. power), the next DumpBuffer sends everything
+
+// Buffer functions
+void ks0108_MarkDirty(ks0108 *this, uint8_t page, uint8_t from, uint8_t to);
+    // note that columns [from, to) of a buffer page have changed
+void ks0108_MarkRows(ks0108 *this, int from, int to, uint8_t x0, uint8_t x1);
+    // note that columns [x0, x1) of buffer rows [from, to) have changed
+uint8_t ks0108_FillBuffer(ks0108 *this, int *x0, int *x1, int *row0, int *row1, uint8_t color);
+    // fill columns [x0, x1) of buffer rows [row0, row1) without marking them dirty,
+    // clips the area in place and returns 0 if none of it is in the buffer
+void ks0108_Invalidate(ks0108 *this);
+    // note that everything on screen has changed
+void ks0108_SetPinned(ks0108 *this, uint8_t x, uint8_t data);
+    // set a column of the pinned overlay (it is drawn over the buffer)
+void ks0108_Flush(ks0108 *this);
+    // send the changed parts of the buffer to the screen, one run per page and chip
+void ks0108_FlushBegin(ks0108 *this);
+    // queue the changed parts of the screen for FlushStep
+uint8_t ks0108_FlushStep(ks0108 *this, uint16_t budget);
+    // send up to budget bus transactions of a flush (call from a timer), nonzero while not done
+    // (interrupts are only held off for one run at a time, so Flush can be used alongside it)
+uint8_t ks0108_FlushPending(ks0108 *this);
+    // nonzero if the screen doesn't show everything in the buffer yet
+#ifdef KS0108_MULTIPANEL
+void ks0108_FlushPanels(ks0108 **panels, uint8_t n);
+    // Flush n panels at once, a byte to each in turn, so one panel's busy time goes on sending to the others
+#endif
+void ks0108_SetStartLine(ks0108 *this, int line);
+    // scroll to a canvas row with the chips' display start line (redrawn by the next flush)
+void ks0108_Scroll(ks0108 *this, int lines);
+    // scroll by any number of rows and redraw what came into view
+void ks0108_SetViewport(ks0108 *this, int x, int y);
+    // show the canvas from column x and row y (SetStartLine, plus a full redraw if x changed)
 
 // END ks0108 class ported from C++ to C
 
-extern volatile ks0108 GLCD; // singleton "class" instance
+extern ks0108 GLCD; // singleton "class" instance
 #endif
@@ -12,22 +12,32 @@
 /*********************************************************/
 /*  Configuration for LCD panel specific configuration   */
 /*********************************************************/
-#define DISPLAY_WIDTH 128
+#ifndef DISPLAY_WIDTH
+#define DISPLAY_WIDTH 128  // 192 for three chips
+#endif
 #define DISPLAY_HEIGHT 64
 
 // panel controller chips
 #define CHIP_WIDTH     64  // pixels per chip 
 
-// you can swap around the elements below if your display is reversed
+// you can swap around the values below if your display is reversed
+// (chip select line values for each chip, a macro so that it folds to a
+// constant wherever the chip is known at compile time)
 #ifdef ksSOURCE
 
+#ifndef CHIPSELECT
 #if (DISPLAY_WIDTH / CHIP_WIDTH  == 2) 
-   byte chipSelect[] = {1,2};        // this is for 128 pixel displays
+#define CHIPSELECT(chip) ((chip) == 0 ? 1 : 2)                  // this is for 128 pixel displays
 #elif (DISPLAY_WIDTH / CHIP_WIDTH  == 3)
-   //byte chipSelect[] = {0, 1, 2};  // this is for 192 pixel displays
-   byte chipSelect[] = {0, 2, 1};  // this is for 192 pixel displays on sanguino only
+//#define CHIPSELECT(chip) (chip)                               // this is for 192 pixel displays
+#define CHIPSELECT(chip) ((chip) == 0 ? 0 : (chip) == 1 ? 2 : 1) // this is for 192 pixel displays on sanguino only
+#endif
 #endif
 
+#if (DISPLAY_WIDTH / CHIP_WIDTH  == 2) 
+#define CHIPSELECT_ALL 3 // both select lines high selects both chips (used for CHIP_ALL)
+#endif                   // 192 pixel panels decode the select lines, so they can't do that
+
 #if (DISPLAY_WIDTH / CHIP_WIDTH  == 2) 
 #define DisableController(chip)    fastWriteLow(CSEL1);   fastWriteLow(CSEL2);   // disable for 128 pixel panels
 #else
@@ -35,8 +45,13 @@
 #endif
 
 #define EN_DELAY_VALUE 6 // this is the delay value that may need to be hand tuned for slow panels
-// go to en_delay.asm to change this value
+// en_delay.asm loads it from ks0108_EnDelay, so it can also be changed at run time
+
+//#define LCD_BUSY_DELAY 1 // EN_DELAY()s that cover the busy time after an access, used between
+// the bytes of a run instead of polling the busy flag. Left out, runs poll until
+// ks0108_Calibrate has measured it: only set it to what ks0108_Calibrate found on
+// this panel, a number that is too small loses writes without any sign of it
 
-#endif // ksSource defined to expose chipSelect only to c file
+#endif // ksSource defined to expose CHIPSELECT only to c file
 
 #endif
@@ -0,0 +1,134 @@
+/* ks0108_list.c
+ * display list for the ks0108 buffer (see ks0108_list.h)
+ */
+
+#include "ks0108_list.h"
+
+void ks0108_ListInit(ks0108_list *list, ks0108 *glcd){
+    list->glcd = glcd;
+    list->count = 0;
+}
+
+// the next free operation, running the list to make room if needed
+static ks0108_op *ks0108_ListAdd(ks0108_list *list, uint8_t op, int x, int y, uint8_t color){
+    ks0108_op *o;
+
+    if(list->count == KS0108_LIST_SIZE)
+        ks0108_ListRun(list);
+    o = &list->ops[list->count++];
+    o->op = op;
+    o->x = x;
+    o->y = y;
+    o->color = color;
+    return o;
+}
+
+void ks0108_ListDot(ks0108_list *list, int x, int y, uint8_t color){
+    ks0108_ListAdd(list, LIST_DOT, x, y, color);
+}
+
+void ks0108_ListSpan(ks0108_list *list, int x, int y, int width, uint8_t color){
+    ks0108_ListAdd(list, LIST_SPAN, x, y, color)->width = width;
+}
+
+void ks0108_ListRect(ks0108_list *list, int x, int y, int width, int height, uint8_t color){
+    ks0108_op *o = ks0108_ListAdd(list, LIST_RECT, x, y, color);
+
+    o->width = width;
+    o->height = height;
+}
+
+void ks0108_ListBlit(ks0108_list *list, const uint8_t *bitmap, int x, int y, uint8_t rop){
+    ks0108_ListAdd(list, LIST_BLIT, x, y, rop)->data = bitmap;
+}
+
+void ks0108_ListText(ks0108_list *list, int x, int y, const char *str){
+    ks0108_ListAdd(list, LIST_TEXT, x, y, 0)->data = str;
+}
+
+void ks0108_ListClear(ks0108_list *list, uint8_t color){
+    ks0108_ListAdd(list, LIST_CLEAR, 0, 0, color);
+}
+
+// apply a run of dots: sort them by buffer page and column (stable, so later
+// dots still win over earlier ones in the same spot), then change each byte once
+static void ks0108_ListDots(ks0108 *glcd, ks0108_op *ops, uint8_t n){
+    uint16_t key[KS0108_LIST_SIZE], k;
+    uint8_t order[KS0108_LIST_SIZE], i, j, o, set, clear, bit, page, x, from, to;
+    int row, col;
+
+    // key = page * 256 + buffer column, 0xFFFF for dots outside the buffer
+    for(i = 0; i < n; i++){
+        row = ops[i].y + glcd->startline;
+        col = ops[i].x + glcd->startcol;
+        if(col < 0 || col >= CANVAS_WIDTH || row < 0 || row >= XPAGES*SCREENS*8)
+            k = 0xFFFF;
+        else
+            k = (row/8) << 8 | col;
+        for(j = i; j > 0 && key[j-1] > k; j--){             // insertion sort, the lists are short
+            key[j] = key[j-1];
+            order[j] = order[j-1];
+        }
+        key[j] = k;
+        order[j] = i;
+    }
+
+    i = 0;
+    while(i < n && key[i] != 0xFFFF){
+        page = key[i] >> 8;
+        from = to = key[i] & 0xFF;
+        while(i < n && key[i] >> 8 == page && (key[i] & 0xFF) <= to + 1){  // adjacent columns of a page
+            x = key[i] & 0xFF;
+            set = clear = 0;
+            for(; i < n && key[i] == (page << 8 | x); i++){     // every dot in this byte, in order
+                o = order[i];
+                bit = BITX((ops[o].y + glcd->startline) % 8);
+                if(ops[o].color == BLACK){
+                    set |= bit;
+                    clear &= ~bit;
+                } else {
+                    clear |= bit;
+                    set &= ~bit;
+                }
+            }
+            glcd->buffer[page][x] = (glcd->buffer[page][x] & ~clear) | set;
+            to = x;
+        }
+        ks0108_MarkDirty(glcd, page, from, to + 1);
+    }
+}
+
+void ks0108_ListRun(ks0108_list *list){
+    ks0108 *glcd = list->glcd;
+    ks0108_op *o;
+    uint8_t i, n;
+
+    for(i = 0; i < list->count; i += n){
+        o = &list->ops[i];
+        n = 1;
+        switch(o->op){
+        case LIST_DOT:                                      // everything up to the next other operation
+            while(i + n < list->count && o[n].op == LIST_DOT)
+                n++;
+            ks0108_ListDots(glcd, o, n);
+            break;
+        case LIST_SPAN:
+            ks0108_DrawHoriLine(glcd, o->x, o->y, o->width, o->color);
+            break;
+        case LIST_RECT:
+            ks0108_FillRect(glcd, o->x, o->y, o->width, o->height, o->color);
+            break;
+        case LIST_BLIT:
+            ks0108_Blit(glcd, o->data, o->x, o->y, o->color);
+            break;
+        case LIST_TEXT:
+            ks0108_CursorToXY(glcd, o->x, o->y);
+            ks0108_Puts(glcd, o->data);
+            break;
+        case LIST_CLEAR:
+            ks0108_FillRect(glcd, 0, 0, DISPLAY_WIDTH-1, DISPLAY_HEIGHT-1, o->color);
+            break;
+        }
+    }
+    list->count = 0;
+}
@@ -0,0 +1,57 @@
+#ifndef KS0108_LIST_H
+#define KS0108_LIST_H
+
+/* ks0108_list.h
+ * display list: record drawing operations now, apply them to the buffer later
+ *
+ * Recording costs no bus traffic at all. ks0108_ListRun applies the whole list
+ * to the buffer in one pass: runs of dots are sorted by page and column so that
+ * every buffer byte they touch is changed once, whatever order the dots came in,
+ * and the flush then sends each touched byte once per frame.
+ * Coordinates are screen coordinates at the time the list is run.
+ */
+
+#include "ks0108.h"
+
+// number of operations a list holds (a full list is run automatically)
+#ifndef KS0108_LIST_SIZE
+#define KS0108_LIST_SIZE 32
+#endif
+
+// operations
+#define LIST_DOT    0   // x, y, color
+#define LIST_SPAN   1   // x, y, width (one less than the number of pixels), color
+#define LIST_RECT   2   // FillRect x, y, width, height, color
+#define LIST_BLIT   3   // bitmap at x, y with raster op
+#define LIST_TEXT   4   // string at x, y in the font and color selected when the list runs
+#define LIST_CLEAR  5   // fill the screen with color
+
+typedef struct {
+    uint8_t             op;
+    uint8_t             color; // color, or raster op for LIST_BLIT
+    int                 x;
+    int                 y;
+    int                 width;
+    int                 height;
+    const void *        data; // bitmap or string
+} ks0108_op;
+
+typedef struct {
+    ks0108 *glcd; // the display the list is run on
+    ks0108_op           ops[KS0108_LIST_SIZE];
+    uint8_t             count; // operations recorded since the last run
+} ks0108_list;
+
+void ks0108_ListInit(ks0108_list *list, ks0108 *glcd);
+    // start an empty list for a display
+void ks0108_ListDot(ks0108_list *list, int x, int y, uint8_t color);
+void ks0108_ListSpan(ks0108_list *list, int x, int y, int width, uint8_t color);
+void ks0108_ListRect(ks0108_list *list, int x, int y, int width, int height, uint8_t color);
+void ks0108_ListBlit(ks0108_list *list, const uint8_t *bitmap, int x, int y, uint8_t rop);
+void ks0108_ListText(ks0108_list *list, int x, int y, const char *str);
+void ks0108_ListClear(ks0108_list *list, uint8_t color);
+    // record an operation (runs the list first if it is full)
+void ks0108_ListRun(ks0108_list *list);
+    // apply everything recorded to the buffer and empty the list (nothing is sent to the screen)
+
+#endif
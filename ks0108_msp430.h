@@ -9,12 +9,15 @@
 
 // command pins
 #define LCD_CMD_PORT        P3OUT       // port on which the command pins reside
+#define LCD_CMD_DIR         P3DIR       // and its direction register
 #define CSEL1               pp(LCD_CMD_PORT,3)      // chip select 1
 #define CSEL2               pp(LCD_CMD_PORT,4)      // chip select 2
 #define R_W                 pp(LCD_CMD_PORT,1)      // read/write
 #define D_I                 pp(LCD_CMD_PORT,0)      // D/I (also R_S in the docs)
 #define EN                  pp(LCD_CMD_PORT,2)      // enable bit
 #define RESET               pp(LCD_CMD_PORT,6)     // reset bit
+#define EN2                 pp(LCD_CMD_PORT,5)      // enable bits of more panels on the same bus
+#define EN3                 pp(LCD_CMD_PORT,7)      // (KS0108_MULTIPANEL, see ks0108_PanelPins)
 
 // these macros  map pins to ports using the defines above  
 #undef LCD_DATA_NIBBLES // we are not using nibble mode (in nibble mode, the data pins
@@ -22,8 +25,16 @@
 #define LCD_DATA_LOW_NBL   7   // port for low nibble
 #define LCD_DATA_HIGH_NBL  LCD_DATA_LOW_NBL   // port for high nibble
 
-// convenience functions for pulling pins high/low
-inline void fastWriteHigh(port,pin) { SETBIT(LCD_CMD_PORT,pin); }
-inline void fastWriteLow(port,pin)  { CLRBIT(LCD_CMD_PORT,pin); }
+// convenience macros for pulling pins high/low
+// the pin is a constant, so each of these is a single bis.b/bic.b on the port
+#define fastWriteHigh(p)    PIN_HIGH_(p)
+#define fastWriteLow(p)     PIN_LOW_(p)
+// set the pins in mask to bits with one write (e.g. both chip selects at once)
+#define fastWritePins(mask, bits) (LCD_CMD_PORT = (LCD_CMD_PORT & ~(mask)) | (bits))
+
+// free-running clock for the instrumentation (KS0108_TRACE, see ks0108_trace.h):
+// Timer A, which paint.c runs in continuous mode from SMCLK/8
+#define KS0108_TRACE_CLOCK  TAR
+#define KS0108_TRACE_HZ     1000000UL
 
 #endif
@@ -0,0 +1,119 @@
+/* ks0108_stroke.c
+ * pen strokes for the ks0108 buffer (see ks0108_stroke.h)
+ */
+
+#include "ks0108_stroke.h"
+
+void ks0108_StrokeInit(ks0108_stroke *stroke, ks0108 *glcd){
+    uint8_t page;
+
+    stroke->glcd = glcd;
+    stroke->width = 1;
+    stroke->color = BLACK;
+    stroke->down = 0;
+    for(page = 0; page < XPAGES*SCREENS; page++){
+        stroke->from[page] = CANVAS_WIDTH;
+        stroke->to[page] = 0;
+    }
+}
+
+void ks0108_StrokeBrush(ks0108_stroke *stroke, uint8_t width, uint8_t color){
+    stroke->width = width ? width : 1;
+    stroke->color = color;
+}
+
+// fill canvas columns [x0, x1) of canvas rows [row0, row1) with the brush
+// color, and remember the damage (ks0108_FillBuffer does the filling, the
+// pages are only marked dirty when the stroke is committed)
+static void ks0108_StrokeFill(ks0108_stroke *stroke, int x0, int x1, int row0, int row1){
+    ks0108 *glcd = stroke->glcd;
+    int page;
+    int offset = ks0108_TopLine(glcd) - glcd->startline;       // canvas row of buffer row 0
+
+    row0 -= offset;
+    row1 -= offset;
+    if(!ks0108_FillBuffer(glcd, &x0, &x1, &row0, &row1, stroke->color))
+        return;
+
+    for(page = row0/8; page*8 < row1; page++){
+        if(x0 < stroke->from[page])
+            stroke->from[page] = x0;
+        if(x1 > stroke->to[page])
+            stroke->to[page] = x1;
+    }
+}
+
+// The brush covers columns x-half .. x-half+width-1 (and the same rows), so a
+// step of the line only adds the column or row on the side it moved to.
+// With the hairline brush this draws the same pixels as ks0108_DrawLine.
+void ks0108_StrokeTo(ks0108_stroke *stroke, int x, int y){
+    int x1, y1, dx, dy, sx, sy, err, e2, w = stroke->width, half = stroke->width/2;
+    uint8_t movedx, movedy;
+
+    x += ks0108_LeftColumn(stroke->glcd);
+    y += ks0108_TopLine(stroke->glcd);
+    if(!stroke->down){
+        ks0108_StrokeFill(stroke, x - half, x - half + w, y - half, y - half + w);
+        stroke->down = 1;
+        stroke->x = x;
+        stroke->y = y;
+        return;
+    }
+
+    x1 = stroke->x;
+    y1 = stroke->y;
+    dx = x > x1 ? x - x1 : x1 - x;
+    dy = y > y1 ? y1 - y : y - y1;                              // negative
+    sx = x1 < x ? 1 : -1;
+    sy = y1 < y ? 1 : -1;
+    err = dx + dy;
+    while(x1 != x || y1 != y){
+        e2 = 2*err;
+        movedx = movedy = 0;
+        if(e2 >= dy){
+            err += dy;
+            x1 += sx;
+            movedx = 1;
+        }
+        if(e2 <= dx){
+            err += dx;
+            y1 += sy;
+            movedy = 1;
+        }
+        if(movedx)                                              // the column the brush moved into
+            ks0108_StrokeFill(stroke, sx > 0 ? x1 - half + w - 1 : x1 - half, sx > 0 ? x1 - half + w : x1 - half + 1,
+                              y1 - half, y1 - half + w);
+        if(movedy && (w > 1 || !movedx))                        // and the row (a hairline's is the same pixel)
+            ks0108_StrokeFill(stroke, x1 - half, x1 - half + w,
+                              sy > 0 ? y1 - half + w - 1 : y1 - half, sy > 0 ? y1 - half + w : y1 - half + 1);
+    }
+    stroke->x = x;
+    stroke->y = y;
+}
+
+void ks0108_StrokeLift(ks0108_stroke *stroke){
+    stroke->down = 0;
+}
+
+void ks0108_StrokeBatch(ks0108_stroke *stroke, const ks0108_strokePoint *points, uint8_t n){
+    uint8_t i;
+
+    for(i = 0; i < n; i++){
+        if(points[i].down)
+            ks0108_StrokeTo(stroke, points[i].x, points[i].y);
+        else
+            ks0108_StrokeLift(stroke);
+    }
+}
+
+void ks0108_StrokeCommit(ks0108_stroke *stroke){
+    uint8_t page;
+
+    for(page = 0; page < XPAGES*SCREENS; page++){
+        if(stroke->from[page] < stroke->to[page]){
+            ks0108_MarkDirty(stroke->glcd, page, stroke->from[page], stroke->to[page]);
+            stroke->from[page] = CANVAS_WIDTH;
+            stroke->to[page] = 0;
+        }
+    }
+}
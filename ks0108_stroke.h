@@ -0,0 +1,51 @@
+#ifndef KS0108_STROKE_H
+#define KS0108_STROKE_H
+
+/* ks0108_stroke.h
+ * pen strokes: join the points of a touch panel stroke with lines of any width
+ *
+ * Each point is joined to the one before by a Bresenham line swept with a
+ * square brush, drawn straight into the buffer: every step of the line only
+ * fills the column and/or row that the brush moved into, so a wide brush costs
+ * about its width per step, not its area. Nothing is marked dirty until
+ * ks0108_StrokeCommit, which hands the damage of everything drawn since the
+ * last commit to the driver in one go, so a stroke that crosses the same bytes
+ * many times in a frame sends each of them once.
+ * Points are screen coordinates when they are added, the stroke remembers them
+ * as canvas coordinates, so it carries on across a scroll. Commit before
+ * scrolling with the tiled canvas (the window may slide under the damage).
+ */
+
+#include "ks0108.h"
+
+typedef struct {
+    int                 x;
+    int                 y;
+    uint8_t             down; // the pen is down at x, y (0 = lifted, x and y don't matter)
+} ks0108_strokePoint;
+
+typedef struct {
+    ks0108 *            glcd; // the display the strokes are drawn on
+    uint8_t             width; // brush size in pixels (a square, 1 = hairline)
+    uint8_t             color;
+    uint8_t             down; // a stroke is in progress
+    int                 x; // where it has got to, in canvas coordinates
+    int                 y;
+    uint8_t             from[XPAGES*SCREENS]; // buffer columns of each buffer page drawn since the last commit
+    uint8_t             to[XPAGES*SCREENS]; // (from >= to means none)
+} ks0108_stroke;
+
+void ks0108_StrokeInit(ks0108_stroke *stroke, ks0108 *glcd);
+    // no stroke in progress, a black hairline brush
+void ks0108_StrokeBrush(ks0108_stroke *stroke, uint8_t width, uint8_t color);
+    // brush for whatever is drawn next (a width of 0 counts as 1)
+void ks0108_StrokeTo(ks0108_stroke *stroke, int x, int y);
+    // put the pen down at x, y: a line from the last point, or a dot at the start of a stroke
+void ks0108_StrokeLift(ks0108_stroke *stroke);
+    // end the stroke, the next point starts a new one
+void ks0108_StrokeBatch(ks0108_stroke *stroke, const ks0108_strokePoint *points, uint8_t n);
+    // StrokeTo or StrokeLift for each of n points, in order
+void ks0108_StrokeCommit(ks0108_stroke *stroke);
+    // mark everything drawn since the last commit dirty (once per frame)
+
+#endif
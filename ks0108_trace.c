@@ -0,0 +1,172 @@
+/* ks0108_trace.c
+ * instrumentation counters and trace ring (see ks0108_trace.h)
+ *
+ * The dump, numbers little endian:
+ *   "KTR1"
+ *   uint8  number of sections (TRACE_SECTIONS), then a 0
+ *   uint16 number of records that follow
+ *   uint32 records made since the last clear (more than follow if the ring went round)
+ *   uint32 clock rate in Hz
+ *   per section: uint16 calls, uint32 total time, uint32 longest time
+ *   per record, oldest first: uint16 time, uint8 id, uint8 arg
+ *     (the first is always a TRACE_EPOCH, so every record's full time is known)
+ *   uint16 sum of all the bytes before it
+ */
+
+#include "ks0108.h"
+#include "ks0108_trace.h"
+
+#ifdef KS0108_TRACE
+
+ks0108_traceCounter ks0108_TraceCounter[TRACE_SECTIONS];
+
+static ks0108_traceRecord ring[KS0108_TRACE_RING];
+static uint32_t made;               // records since the last clear, the next one goes in ring[made % KS0108_TRACE_RING]
+static uint16_t high, low;          // the clock at the last look
+static uint16_t epoch;              // high half in the last TRACE_EPOCH record
+static uint16_t oldestEpoch;        // and the one that applies to the oldest record in the ring
+static uint32_t lockStart;          // KS0108_LOCK doesn't nest with interrupts on, so one will do
+static uint8_t paused;              // a dump is reading the ring
+static uint16_t sum;
+
+// read the clock (with interrupts off)
+static uint32_t ks0108_TraceNow(void){
+#ifdef KS0108_TRACE_CLOCK32
+    uint32_t now = KS0108_TRACE_CLOCK32;
+
+    high = now >> 16;
+    low = now;
+    return now;
+#else
+    uint16_t now = KS0108_TRACE_CLOCK;
+
+    if(now < low)
+        high++;
+    low = now;
+    return (uint32_t)high << 16 | now;
+#endif
+}
+
+static void ks0108_TracePush(uint8_t id, uint8_t arg, uint16_t time){
+    ks0108_traceRecord *r = &ring[made & (KS0108_TRACE_RING-1)];
+
+    if(made >= KS0108_TRACE_RING && r->id == TRACE_EPOCH)   // going round: keep track of the oldest epoch
+        oldestEpoch = r->time;
+    r->time = time;
+    r->id = id;
+    r->arg = arg;
+    made++;
+}
+
+// a record at now, after the epoch it is in
+static void ks0108_TraceRecord(uint8_t id, uint8_t arg, uint32_t now){
+    if(high != epoch){
+        epoch = high;
+        ks0108_TracePush(TRACE_EPOCH, 0, high);
+    }
+    ks0108_TracePush(id, arg, now);
+}
+
+uint32_t ks0108_TraceBegin(uint8_t id, uint8_t arg){
+    uint16_t s;
+    uint32_t now;
+
+    KS0108_IRQ_SAVE(s);
+    now = ks0108_TraceNow();
+    if(!paused)
+        ks0108_TraceRecord(id, arg, now);
+    KS0108_IRQ_RESTORE(s);
+    return now;
+}
+
+void ks0108_TraceEnd(uint32_t start, uint8_t id, uint8_t arg){
+    ks0108_traceCounter *c = &ks0108_TraceCounter[id];
+    uint16_t s;
+    uint32_t now;
+
+    KS0108_IRQ_SAVE(s);
+    now = ks0108_TraceNow();
+    if(!paused){
+        ks0108_TraceRecord(id | TRACE_END, arg, now);
+        c->calls++;
+        c->time += now - start;
+        if(now - start > c->longest)
+            c->longest = now - start;
+    }
+    KS0108_IRQ_RESTORE(s);
+}
+
+void ks0108_TraceLock(void){
+    lockStart = ks0108_TraceBegin(TRACE_LOCK, 0);
+}
+
+void ks0108_TraceUnlock(void){
+    ks0108_TraceEnd(lockStart, TRACE_LOCK, 0);
+}
+
+void ks0108_TraceTick(void){
+    uint16_t s;
+
+    KS0108_IRQ_SAVE(s);
+    ks0108_TraceNow();
+    KS0108_IRQ_RESTORE(s);
+}
+
+void ks0108_TraceClear(void){
+    uint8_t i;
+    uint16_t s;
+
+    KS0108_IRQ_SAVE(s);
+    for(i = 0; i < TRACE_SECTIONS; i++){
+        ks0108_TraceCounter[i].calls = 0;
+        ks0108_TraceCounter[i].time = 0;
+        ks0108_TraceCounter[i].longest = 0;
+    }
+    ks0108_TraceNow();
+    made = 0;
+    epoch = oldestEpoch = high;
+    KS0108_IRQ_RESTORE(s);
+}
+
+static void ks0108_TracePut(void (*put)(uint8_t byte), uint32_t value, uint8_t bytes){
+    for(; bytes; bytes--, value >>= 8){
+        sum += (uint8_t)value;
+        put(value);
+    }
+}
+
+void ks0108_TraceDump(void (*put)(uint8_t byte)){
+    uint32_t i, first;
+    uint16_t count;
+    const char *magic = "KTR1";
+
+    paused = 1;                                     // whatever happens meanwhile isn't recorded
+    sum = 0;
+    count = made < KS0108_TRACE_RING ? made : KS0108_TRACE_RING;
+    first = made - count;
+    for(; *magic; magic++)
+        ks0108_TracePut(put, *magic, 1);
+    ks0108_TracePut(put, TRACE_SECTIONS, 1);
+    ks0108_TracePut(put, 0, 1);
+    ks0108_TracePut(put, count + 1, 2);
+    ks0108_TracePut(put, made, 4);
+    ks0108_TracePut(put, KS0108_TRACE_HZ, 4);
+    for(i = 0; i < TRACE_SECTIONS; i++){
+        ks0108_TracePut(put, ks0108_TraceCounter[i].calls, 2);
+        ks0108_TracePut(put, ks0108_TraceCounter[i].time, 4);
+        ks0108_TracePut(put, ks0108_TraceCounter[i].longest, 4);
+    }
+    ks0108_TracePut(put, oldestEpoch, 2);
+    ks0108_TracePut(put, TRACE_EPOCH, 1);
+    ks0108_TracePut(put, 0, 1);
+    for(i = first; i < made; i++){
+        ks0108_TracePut(put, ring[i & (KS0108_TRACE_RING-1)].time, 2);
+        ks0108_TracePut(put, ring[i & (KS0108_TRACE_RING-1)].id, 1);
+        ks0108_TracePut(put, ring[i & (KS0108_TRACE_RING-1)].arg, 1);
+    }
+    put(sum);
+    put(sum >> 8);
+    paused = 0;
+}
+
+#endif
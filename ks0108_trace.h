@@ -0,0 +1,86 @@
+#ifndef KS0108_TRACE_H
+#define KS0108_TRACE_H
+
+/* ks0108_trace.h
+ * optional instrumentation of the driver and the interrupt handlers around it
+ *
+ * With KS0108_TRACE defined, every traced section keeps a call count, its
+ * total and longest time, and puts a begin and an end record (with a
+ * timestamp and an argument) in a ring of the last KS0108_TRACE_RING records.
+ * ks0108_TraceDump sends all of it, one byte at a time, to whatever the
+ * application has for talking to the host (a UART on the MSP430, a file in the
+ * host bench), and host/tracedecode.c turns that into text.
+ * Without KS0108_TRACE the macros are empty and ks0108_trace.c is empty.
+ *
+ * Time comes from KS0108_TRACE_CLOCK, a free-running 16-bit timer counting at
+ * KS0108_TRACE_HZ (see ks0108_msp430.h), made 32 bits wide by noticing when
+ * it wraps. Something has to look at it more often than that:
+ * KS0108_TRACE_TICK() from a periodic interrupt is enough. A host build can
+ * give a 32-bit KS0108_TRACE_CLOCK32 instead.
+ */
+
+#include <inttypes.h>
+
+// what is traced (the numbers are part of the dump format, add new ones at the end)
+#define TRACE_BUSY          0   // waiting for a chip's busy flag (or BusyDelay), arg = chip
+#define TRACE_GOTOXY        1   // begin arg = x, end arg = commands sent
+#define TRACE_COMMAND       2   // an instruction on the bus (busy wait included), arg = the command
+#define TRACE_FLUSHSTEP     3   // end arg = 1 if there is more to send
+#define TRACE_LOCK          4   // interrupts off under KS0108_LOCK (outermost lock only)
+#define TRACE_IRQOFF        5   // interrupts off in the application, arg = where (see paint.c)
+#define TRACE_SECTIONS      6
+
+#define TRACE_END           0x80    // or'ed into the id of an end record
+#define TRACE_EPOCH         0x7F    // the high half of the clock, in the time field of the record
+
+#ifndef KS0108_TRACE_RING
+#define KS0108_TRACE_RING   128     // records, a power of two
+#endif
+
+#ifdef KS0108_TRACE
+
+typedef struct {
+    uint16_t            time; // low half of the clock
+    uint8_t             id; // TRACE_ section, | TRACE_END on the way out
+    uint8_t             arg;
+} ks0108_traceRecord;
+
+typedef struct {
+    uint16_t            calls;
+    uint32_t            time; // clock ticks spent inside, in total
+    uint32_t            longest;
+} ks0108_traceCounter;
+
+extern ks0108_traceCounter ks0108_TraceCounter[TRACE_SECTIONS];
+
+uint32_t ks0108_TraceBegin(uint8_t id, uint8_t arg);
+    // record the start of a section, returns the time for ks0108_TraceEnd
+void ks0108_TraceEnd(uint32_t start, uint8_t id, uint8_t arg);
+    // record its end and count it
+void ks0108_TraceLock(void);
+void ks0108_TraceUnlock(void);
+    // the same for KS0108_LOCK, which has nowhere to keep the start
+void ks0108_TraceTick(void);
+    // look at the clock so that it doesn't wrap unnoticed
+void ks0108_TraceClear(void);
+    // zero the counters and empty the ring
+void ks0108_TraceDump(void (*put)(uint8_t byte));
+    // send the counters and the ring (format in ks0108_trace.c)
+
+// the start of a section is kept in a local: declare it with the other locals
+// (no semicolon after it), then begin and end the section with the same name
+#define KS0108_TRACE_DECL(t)            uint32_t t;
+#define KS0108_TRACE_BEGIN(t, id, arg)  ((t) = ks0108_TraceBegin(id, arg))
+#define KS0108_TRACE_END(t, id, arg)    ks0108_TraceEnd(t, id, arg)
+#define KS0108_TRACE_TICK()             ks0108_TraceTick()
+
+#else
+
+#define KS0108_TRACE_DECL(t)
+#define KS0108_TRACE_BEGIN(t, id, arg)  ((void)0)
+#define KS0108_TRACE_END(t, id, arg)    ((void)(arg))   // (arg is still worked out, it may be all a local is for)
+#define KS0108_TRACE_TICK()             ((void)0)
+
+#endif
+
+#endif
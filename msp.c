@@ -7,7 +7,7 @@
 #include "ks0108.h"
 
 // singleton "class" instance
-volatile ks0108 GLCD;
+ks0108 GLCD;
 
 // set a pin to input or output
 // re-implentation of the Arduino's function of the same name
@@ -9,7 +9,11 @@
  */
 
 // our processor
+#ifdef KS0108_HOST
+#include "host/ks0108_sim.h" // stand-in registers backed by the PC bus model
+#else
 #include "msp430fg4618.h"
+#endif
 
 // UTILITY MACROS (these are useful, i.e. PxDIR(3) expands to P3DIR at compile time)
 #define PXGLUE(a,b,c)	a ## b ## c
@@ -25,8 +29,35 @@
 
 // COMPATIBILITY HACKS
 extern void EN_DELAY(void); // implemented in en_delay.asm
+extern unsigned int ks0108_EnDelay; // loop count for EN_DELAY (defined in ks0108.c)
 extern void delay(unsigned int); // delay for X milliseconds
 
+// critical sections around the driver state that ks0108_FlushStep shares when it is
+// called from an interrupt handler. s (a uint16_t) keeps the interrupt enable so that
+// they nest, in an interrupt handler they don't turn interrupts back on. The barrier
+// keeps the compiler from moving buffer accesses across them (the state isn't volatile).
+#ifdef __GNUC__
+#define KS0108_BARRIER()    __asm__ __volatile__("" ::: "memory")
+#else
+#define KS0108_BARRIER()    // the TI compiler doesn't move memory accesses across the intrinsics
+#endif
+#ifdef KS0108_HOST
+#define KS0108_IRQ_SAVE(s)      do { (s) = ks0108_SimInterrupts; ks0108_SimInterrupts = 0; KS0108_BARRIER(); } while(0)
+#define KS0108_IRQ_RESTORE(s)   do { KS0108_BARRIER(); if(s) ks0108_SimInterrupts = 1; } while(0)
+#else
+#define KS0108_IRQ_SAVE(s)      do { (s) = __get_SR_register() & GIE; __disable_interrupt(); KS0108_BARRIER(); } while(0)
+#define KS0108_IRQ_RESTORE(s)   do { KS0108_BARRIER(); if(s) __enable_interrupt(); } while(0)
+#endif
+// the same, timed by the instrumentation (KS0108_TRACE) when they turn interrupts off
+#include "ks0108_trace.h"
+#ifdef KS0108_TRACE
+#define KS0108_LOCK(s)      do { KS0108_IRQ_SAVE(s); if(s) ks0108_TraceLock(); } while(0)
+#define KS0108_UNLOCK(s)    do { if(s) ks0108_TraceUnlock(); KS0108_IRQ_RESTORE(s); } while(0)
+#else
+#define KS0108_LOCK(s)      KS0108_IRQ_SAVE(s)
+#define KS0108_UNLOCK(s)    KS0108_IRQ_RESTORE(s)
+#endif
+
 // in ks0108_msp430.h this is used for pin definitions, i.e. P4.2 is denoted as pp(4,2)
 // the macro adds flexibility -- it could, for instance, pack them into a struct or
 //      an unsigned long
@@ -34,7 +65,16 @@ extern void delay(unsigned int); // delay for X milliseconds
 //      correct order, so this works fine
 #define pp(a,b) a,b
 
-// this is implemented in msp.c
+// split a pin definition back up, i.e. PIN_BIT(pp(4,2)) is BITX(2), a constant
+// (the extra level lets the pin's name expand to its two parts first)
+#define PIN_BIT_(port, pin) BITX(pin)
+#define PIN_BIT(p) PIN_BIT_(p)
+#define PIN_HIGH_(port, pin) (SETBIT(port, pin))
+#define PIN_LOW_(port, pin) (CLRBIT(port, pin))
+
+// this is implemented in msp.c (or host/ks0108_sim.c), the port is picked at run time
+// (the driver writes LCD_CMD_DIR with PIN_BIT()s instead)
+typedef enum { INPUT, OUTPUT } pin_mode;
 void pinMode(unsigned char port, unsigned char pin, pin_mode mode);
 
 #endif
@@ -0,0 +1,109 @@
+#include "touchcal.h"
+
+// the one place a divide is needed: a coefficient is num/det in fixed point,
+// with num up to about 2^20 and det up to 2^24, so this needs 64 bits
+static char touchcal_coef(long num, long det, int *coef)
+{
+    long long q = (long long)num * TOUCHCAL_ONE / det;
+
+    if (q > 32767 || q < -32768)
+        return 0;
+    *coef = (int)q;
+    return 1;
+}
+
+// Cramer's rule on
+//   sx = a*rx + b*ry + c    sy = d*rx + e*ry + f
+// for the three points, with everything taken relative to the third so that c
+// and f drop out of the 2x2 solve
+char touchcal_solve(touchCal *cal, const unsigned int raw[3][2], const int screen[3][2])
+{
+    long rx1 = (long)raw[0][0] - raw[2][0], ry1 = (long)raw[0][1] - raw[2][1];
+    long rx2 = (long)raw[1][0] - raw[2][0], ry2 = (long)raw[1][1] - raw[2][1];
+    long sx1 = screen[0][0] - screen[2][0], sy1 = screen[0][1] - screen[2][1];
+    long sx2 = screen[1][0] - screen[2][0], sy2 = screen[1][1] - screen[2][1];
+    long det = rx1*ry2 - rx2*ry1;
+    touchCal c;
+
+    if (det == 0)
+        return 0;
+    if (!touchcal_coef(sx1*ry2 - sx2*ry1, det, &c.a) || !touchcal_coef(rx1*sx2 - rx2*sx1, det, &c.b) ||
+        !touchcal_coef(sy1*ry2 - sy2*ry1, det, &c.d) || !touchcal_coef(rx1*sy2 - rx2*sy1, det, &c.e))
+        return 0;
+    c.c = (long)screen[2][0] * TOUCHCAL_ONE - (long)c.a*raw[2][0] - (long)c.b*raw[2][1];
+    c.f = (long)screen[2][1] * TOUCHCAL_ONE - (long)c.d*raw[2][0] - (long)c.e*raw[2][1];
+    *cal = c;
+    return 1;
+}
+
+void touchcal_map(const touchCal *cal, unsigned int rx, unsigned int ry, int *x, int *y)
+{
+    // readings are 12 bits, so they pass through int unchanged
+    *x = (int)(((long)cal->a*(int)rx + (long)cal->b*(int)ry + cal->c) >> TOUCHCAL_SHIFT);
+    *y = (int)(((long)cal->d*(int)rx + (long)cal->e*(int)ry + cal->f) >> TOUCHCAL_SHIFT);
+}
+
+// middle of the window, by insertion sort of a copy (TOUCH_MEDIAN is tiny)
+static unsigned int touchfilter_median(const unsigned int *window)
+{
+    unsigned int v[TOUCH_MEDIAN], t;
+    unsigned char i, j;
+
+    for (i = 0; i < TOUCH_MEDIAN; i++)
+    {
+        t = window[i];
+        for (j = i; j > 0 && v[j-1] > t; j--)
+            v[j] = v[j-1];
+        v[j] = t;
+    }
+    return v[TOUCH_MEDIAN/2];
+}
+
+void touchfilter_reset(touchFilter *f)
+{
+    f->next = 0;
+    f->count = 0;
+    f->down = 0;
+}
+
+char touchfilter_feed(touchFilter *f, unsigned int rx, unsigned int ry, char inrange, char lowpass)
+{
+    unsigned int mx, my;
+
+    if (!inrange)
+    {
+        if (f->down && ++f->count < TOUCH_UP_READINGS) // a short dropout doesn't end the stroke
+            return 1;
+        f->down = 0;
+        f->count = 0;
+        return 0;
+    }
+
+    f->x[f->next] = rx;
+    f->y[f->next] = ry;
+    f->next = f->next == TOUCH_MEDIAN-1 ? 0 : f->next + 1;
+    if (!f->down)
+    {
+        // still settling: the first readings as the pen comes down are
+        // somewhere between the edge of the panel and the touch
+        if (++f->count < TOUCH_DOWN_READINGS)
+            return 0;
+        f->down = 1;
+        f->count = 0;
+        f->fx = touchfilter_median(f->x);
+        f->fy = touchfilter_median(f->y);
+        return 1;
+    }
+    f->count = 0;
+
+    mx = touchfilter_median(f->x);
+    my = touchfilter_median(f->y);
+    if (lowpass) // 3:1 running average, 12-bit readings so 4*4095 fits
+    {
+        mx = (f->fx*3 + mx) >> 2;
+        my = (f->fy*3 + my) >> 2;
+    }
+    f->fx = mx;
+    f->fy = my;
+    return 1;
+}
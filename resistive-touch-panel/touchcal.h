@@ -0,0 +1,72 @@
+#ifndef TOUCHCAL_H_
+#define TOUCHCAL_H_
+
+// Turning raw ADC readings into screen coordinates, without divides (the
+// MSP430 has a hardware multiplier but no divider):
+//  - touchFilter rejects spikes with a median of the last TOUCH_MEDIAN readings,
+//    optionally smooths with a 3:1 running average done with shifts, and
+//    debounces the pen: it only counts as down after TOUCH_DOWN_READINGS good
+//    readings in a row, and as up after TOUCH_UP_READINGS bad ones
+//  - touchCal maps the filtered reading to the screen with an affine matrix in
+//    fixed point, so rotated or skewed panels work as well as the usual
+//    "subtract an offset and divide" ones
+
+#define TOUCHCAL_SHIFT 16 // fraction bits of the calibration coefficients
+#define TOUCHCAL_ONE (1L << TOUCHCAL_SHIFT) // 1.0 in that fixed point (scale by multiplying: negatives can't be shifted left)
+
+// screen x = (a*raw x + b*raw y + c) >> TOUCHCAL_SHIFT
+// screen y = (d*raw x + e*raw y + f) >> TOUCHCAL_SHIFT
+// a, b, d and e fit an int because a 12-bit ADC spans a panel with more
+// counts than the screen has pixels (|coefficient| < 0.5), so each product is
+// a single 16x16 multiply.
+typedef struct {
+    int a, b;
+    long c;
+    int d, e;
+    long f;
+} touchCal;
+
+// a calibration for a panel that isn't rotated, from the raw readings at two
+// edges of each axis and the screen coordinates they should land on (this is
+// a constant expression, so it can initialise a static touchCal)
+#define TOUCHCAL_RANGE_(r0, r1, s0, s1) \
+    ((int)((((long)(s1) - (s0)) * TOUCHCAL_ONE) / ((long)(r1) - (r0))))
+#define TOUCHCAL_RANGES(rx0, rx1, sx0, sx1, ry0, ry1, sy0, sy1) { \
+    TOUCHCAL_RANGE_(rx0, rx1, sx0, sx1), 0, \
+    (long)(sx0) * TOUCHCAL_ONE - (long)(rx0) * TOUCHCAL_RANGE_(rx0, rx1, sx0, sx1), \
+    0, TOUCHCAL_RANGE_(ry0, ry1, sy0, sy1), \
+    (long)(sy0) * TOUCHCAL_ONE - (long)(ry0) * TOUCHCAL_RANGE_(ry0, ry1, sy0, sy1) }
+
+char touchcal_solve(touchCal *cal, const unsigned int raw[3][2], const int screen[3][2]);
+    // work out the calibration from the raw readings (x, y) of three touches on
+    // known screen points (x, y), which mustn't be in a line. Returns 0 (and
+    // leaves cal alone) if they are, or if a coefficient doesn't fit.
+    // This divides, but only once per calibration.
+void touchcal_map(const touchCal *cal, unsigned int rx, unsigned int ry, int *x, int *y);
+    // screen coordinates of a raw reading (not clipped to the screen)
+
+#define TOUCH_MEDIAN 3          // readings in the spike filter window (odd, and small: it is sorted every reading)
+#define TOUCH_DOWN_READINGS 10  // good readings in a row before the pen is down
+#define TOUCH_UP_READINGS 2     // bad readings in a row before the pen is up
+
+#if TOUCH_DOWN_READINGS < TOUCH_MEDIAN
+#error "the median window has to be full of the new stroke when the pen comes down"
+#endif
+
+typedef struct {
+    unsigned int x[TOUCH_MEDIAN], y[TOUCH_MEDIAN]; // the last readings, oldest at next
+    unsigned char next;     // where the next reading goes
+    unsigned char count;    // readings in a row that disagree with down
+    char down;              // the pen is down
+    unsigned int fx, fy;    // the filtered position, while down
+} touchFilter;
+
+void touchfilter_reset(touchFilter *f);
+    // pen up, window empty
+char touchfilter_feed(touchFilter *f, unsigned int rx, unsigned int ry, char inrange, char lowpass);
+    // take one complete reading. inrange says whether it looked like a touch at
+    // all. Returns 1 while the pen is down, with fx/fy updated (a reading that
+    // is out of range but too short to lift the pen keeps the old position),
+    // or 0 while it is up.
+
+#endif /*TOUCHCAL_H_*/
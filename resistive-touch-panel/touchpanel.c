@@ -1,9 +1,61 @@
 #include "touchscreen.h"
 
-volatile unsigned long xx, yy;
+volatile unsigned int xx, yy;
 volatile char lopass = 1;
-volatile long firstx, firsty;
-volatile int wasvalid = 0;
+
+static touchFilter filter = {{0}, {0}, 0, 0, 0, 0, 0}; // pen up
+static unsigned int rawx;   // the X half of the reading in progress
+static char inrangex;       // and whether it was in range
+
+volatile unsigned int touchTicks = 0;
+volatile unsigned int touchDropped = 0;
+
+// single producer (ADC12_ISR), single consumer (touch_read) ring of samples
+// one slot is always left empty, so head == tail means empty
+static volatile touchSample queue[TOUCH_QUEUE];
+static volatile unsigned char touchHead = 0, touchTail = 0;
+static char pressed = 0; // the last sample queued was valid
+
+// queue a sample (from ADC12_ISR only), returns 0 if the queue was full
+static char touch_push(unsigned int x, unsigned int y, char valid)
+{
+    unsigned char head = touchHead, next = (head + 1) & (TOUCH_QUEUE - 1);
+    
+    if (next == touchTail)
+    {
+        ++touchDropped;
+        return 0;
+    }
+    queue[head].x = x;
+    queue[head].y = y;
+    queue[head].time = touchTicks;
+    queue[head].valid = valid;
+    touchHead = next; // publish it (after the sample, both are volatile)
+    return 1;
+}
+
+unsigned char touch_pending()
+{
+    return (touchHead - touchTail) & (TOUCH_QUEUE - 1);
+}
+
+// copy out up to max samples and free their slots
+unsigned char touch_read(touchSample *samples, unsigned char max)
+{
+    unsigned char tail = touchTail, head = touchHead, n = 0;
+    
+    while (tail != head && n < max)
+    {
+        samples[n].x = queue[tail].x;
+        samples[n].y = queue[tail].y;
+        samples[n].time = queue[tail].time;
+        samples[n].valid = queue[tail].valid;
+        ++n;
+        tail = (tail + 1) & (TOUCH_QUEUE - 1);
+    }
+    touchTail = tail; // hand the slots back to the ISR
+    return n;
+}
 
 // for vertical reading, set bot=0, top=5, read right
 void setup_vert()
@@ -32,46 +84,25 @@ __interrupt void TB0_ISR(void)
 {
     // Start another conversion
     ADC12CTL0 |= ADC12SC;
+    ++touchTicks;
 }
 
 #pragma vector=ADC12_VECTOR
 __interrupt void ADC12_ISR(void)
 {
-    int i;
+    KS0108_TRACE_DECL(t)
     
     // disable interrupts so that this function runs in full
     _bic_SR_register(GIE);
+    KS0108_TRACE_BEGIN(t, TRACE_IRQOFF, 2); // (see paint.c)
 
     
     // grab the x or y coordinate, then switch the ADC to read the other one
     // during the next interrupt
     if ((ADC12CTL1 & 0xF000) == 0) // we have a value for TTOP
     {
-        if (ADC12MEM0 > 500 && ADC12MEM0 < 2900 && ADC12MEM1 > 700 && ADC12MEM1 < 3500) // range checking
-        {
-            if (wasvalid < IGNORE) // if we are still in the startup transient
-            {
-                ++wasvalid;
-            }
-            else // we are out of the startup transient
-            {
-                xx = lopass ? (xx*3 + ADC12MEM0)/4 : ADC12MEM0; // simple averaging low-pass filter (if enabled)
-                if (wasvalid == IGNORE || wasvalid == IGNORE+1)
-                { // if we are just coming out of the startup transient, we want to remember
-                    // the first valid set of coordinates.
-                    // either the first X coord will be remembered first (in which case wasvalid==IGNORE
-                    // and then it is incremented here to IGNORE+1) and then the Y coord will be remembered
-                    // next time the ISR is called, or vice versa. therefore, when wasvalid >IGNORE+1, firstx
-                    // and firsty are trustworthy.
-                    firstx = xx;
-                    ++wasvalid; // so that the coords don't get remembered again
-                }
-            }
-        }
-        else // if out of range, reset the startup transient counter
-        {
-            wasvalid = 0;
-        }
+        rawx = ADC12MEM0;
+        inrangex = rawx > TOUCH_X_MIN && rawx < TOUCH_X_MAX;
         
         // prepare to read the vertical axis
         setup_vert();
@@ -82,28 +113,22 @@ __interrupt void ADC12_ISR(void)
     }
     else // we have a value for TRIGHT
     {
-        if (ADC12MEM1 > 700 && ADC12MEM1 < 3500 && ADC12MEM0 > 500 && ADC12MEM0 < 2900) // range checking
+        unsigned int rawy = ADC12MEM1;
+        
+        // the reading is complete: filter it, then queue it, or the end of the
+        // stroke once (if that doesn't fit it is tried again with the next reading)
+        if (touchfilter_feed(&filter, rawx, rawy, inrangex && rawy > TOUCH_Y_MIN && rawy < TOUCH_Y_MAX, lopass))
         {
-            if (wasvalid < IGNORE) // if we are still in the startup transient
-            {
-                ++wasvalid;
-            }
-            else // we are out of the startup transient
-            {
-                yy = lopass ? (yy*3 + ADC12MEM1)/4 : ADC12MEM1; // simple averaging low-pass filter (if enabled)
-                if (wasvalid == IGNORE || wasvalid == IGNORE+1) // see explanation of this at xx above
-                {
-                    firsty = yy;
-                    ++wasvalid; // so that the coords don't get remembered again
-                }
-            }
+            xx = filter.fx;
+            yy = filter.fy;
+            pressed = touch_push(xx, yy, 1) || pressed;
         }
-        else // if out of range, reset the startup transient counter
+        else if (pressed)
         {
-            wasvalid = 0;
+            pressed = !touch_push(xx, yy, 0);
         }
         
-        // prepare to read the vertical axis
+        // prepare to read the horizontal axis
         setup_horiz();
         ADC12CTL0 &= ~ENC;
         ADC12CTL1 &= 0x0fff;
@@ -112,6 +137,7 @@ __interrupt void ADC12_ISR(void)
     }
     
     // turn back on interrupts
+    KS0108_TRACE_END(t, TRACE_IRQOFF, 2);
     __bis_SR_register(GIE);
     
     __bic_SR_register_on_exit(LPM0_bits); // wake up so we can start the next conversion
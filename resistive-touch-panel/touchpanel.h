@@ -3,23 +3,42 @@
 
 #include "msp.h"
 
-extern volatile unsigned long xx, yy; // the current coordinates being read
-
-// when the panel is not being touched, we read a value with an invalid Y
-// coordinate, so it is easy to ignore that. However, as the finger/stylus
-// comes down, there are some invalid points in between this invalid coordinate
-// and the real data. In draw mode with the pencil, you get a line from the edge
-// of the screen to the touch position. In scroll mode, it might scroll the
-// wrong way. To fix this, when the data is invalid wasvalid is set to zero,
-// and when the data is valid wasvalid is increased BUT the data is ignored until
-// wasvalid reaches IGNORE/IGNORE+1.
-extern volatile int wasvalid;
-extern volatile long firstx, firsty; // these remember the coordinates from when
-                    // wasvalid hit IGNORE/IGNORE+1 (this is needed for scrolling)
-#define IGNORE 30 // number of data points to ignore
+#include "touchcal.h"
+
+extern volatile unsigned int xx, yy; // the current coordinates being read (filtered, while the pen is down)
+
+// raw readings outside these ranges aren't a touch: when the panel is not being
+// touched, the Y reading is off the end, so it is easy to ignore. As the
+// finger/stylus comes down there are some readings in between that are in range
+// but wrong; in draw mode you would get a line from the edge of the screen, and
+// in scroll mode it might scroll the wrong way. The touchFilter debouncer (see
+// touchcal.h) waits for them to settle before the pen counts as down.
+#define TOUCH_X_MIN 500
+#define TOUCH_X_MAX 2900
+#define TOUCH_Y_MIN 700
+#define TOUCH_Y_MAX 3500
 
 extern volatile char lopass; // whether the low-pass filter is enabled
 
+// Every complete reading (X and Y) is also queued for the main loop, so that
+// none are lost while it is busy (e.g. flushing the LCD). ADC12_ISR is the only
+// writer of touchHead and the main loop the only writer of touchTail, so neither
+// side has to turn interrupts off. When the panel is let go, one sample with
+// valid == 0 is queued to end the stroke.
+typedef struct {
+    unsigned int x, y;      // ADC readings, spike filtered (and low-pass filtered if lopass is set)
+    unsigned int time;      // touchTicks when the reading was complete
+    char valid;             // the pen is down (debounced)
+} touchSample;
+
+#define TOUCH_QUEUE 32 // samples, a power of two (one reading takes two Timer B periods)
+
+extern volatile unsigned int touchTicks; // Timer B periods since start up
+extern volatile unsigned int touchDropped; // samples that didn't fit in the queue
+
+unsigned char touch_pending(); // number of samples waiting
+unsigned char touch_read(touchSample *samples, unsigned char max); // take up to max samples, oldest first
+
 // touch panel pins
 #define TPORT       6 // has to be port 6 because that's where the ADC is
 #define TRIGHT      3